@@ -20,6 +20,9 @@ INCLUDEPATH += $$MY_PWD/libs/boost/include
 INCLUDEPATH += $$MY_PWD/libs/openssl/include
 LIBS += -L$$MY_PWD/libs/openssl/libs -lssl -lcrypto
 
+# zlib（IMAP COMPRESS=DEFLATE），使用工具链自带的库
+LIBS += -lz
+
 # Windows 平台特定的库链接
 win32 {
     # Windows Socket 库
@@ -41,7 +44,27 @@ SOURCES += \
     trayicon.cpp \
     accountdialog.cpp \
     emailclient.cpp \
-    composedialog.cpp
+    composedialog.cpp \
+    mailstore.cpp \
+    pop3seenset.cpp \
+    imapsession.cpp \
+    imapresponse.cpp \
+    linereader.cpp \
+    deflatestream.cpp \
+    asyncdialog.cpp \
+    tlssessioncache.cpp \
+    hostresolver.cpp \
+    imapidleclient.cpp \
+    smtpsession.cpp \
+    pop3session.cpp \
+    outbox.cpp \
+    mimewriter.cpp \
+    bulksender.cpp \
+    mailboxmodel.cpp \
+    mailitemdelegate.cpp \
+    searchindex.cpp \
+    mimeview.cpp \
+    mimecodec.cpp
 
 HEADERS += \
     mainwindow.h \
@@ -49,7 +72,27 @@ HEADERS += \
     trayicon.h \
     accountdialog.h \
     emailclient.h \
-    composedialog.h
+    composedialog.h \
+    mailstore.h \
+    pop3seenset.h \
+    imapsession.h \
+    imapresponse.h \
+    linereader.h \
+    deflatestream.h \
+    asyncdialog.h \
+    tlssessioncache.h \
+    hostresolver.h \
+    imapidleclient.h \
+    smtpsession.h \
+    pop3session.h \
+    outbox.h \
+    mimewriter.h \
+    bulksender.h \
+    mailboxmodel.h \
+    mailitemdelegate.h \
+    searchindex.h \
+    mimeview.h \
+    mimecodec.h
 
 FORMS += \
     mainwindow.ui \
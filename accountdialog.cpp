@@ -256,6 +256,7 @@ void AccountDialog::onAddAccountClicked()
     accounts.append(account);
     saveAccounts();
     updateAccountList();
+    emit accountsChanged();
 
     // 清空输入框
     ui->nameEdit->clear();
@@ -277,6 +278,7 @@ void AccountDialog::onDeleteAccountClicked()
         saveAccounts();
         updateAccountList();
         currentAccountIndex = -1;
+        emit accountsChanged();
     }
 }
 
@@ -4,6 +4,7 @@
 #include <QDialog>
 #include <QListWidgetItem>
 #include <QDateTime>  // 添加这行
+#include <QMetaType>
 
 namespace Ui {
 class AccountDialog;
@@ -19,7 +20,17 @@ struct Email {
     QDateTime time;  // 现在QDateTime已包含
     bool isRead;
     bool isFavorite;
+    bool isTrashed = false;
+    QString folder;          // 所在服务器文件夹（IMAP）
+    // IMAP 为服务器 UID；POP3 为 Pop3SeenSet 分配的本地 UID，跨会话不变，
+    // 本次会话中的邮件序号由 EmailClient::pop3Number() 查出。0 表示本地邮件
+    unsigned long uid = 0;
+    bool bodyLoaded = true;  // 只同步了邮件头时为 false，打开时再下载正文
+    int sendState = 0;       // 发件箱中的状态（Outbox::State），0 表示已发送
+    QString sendError;       // 最近一次发送失败的原因
+    QString account;         // 所属账户的邮箱地址，不同账户的 id 可能相同
 };
+Q_DECLARE_METATYPE(Email)
 
 struct EmailAccount {
     QString name;
@@ -46,9 +57,13 @@ public:
 
     QString getCurrentAccountEmail() const;
     EmailAccount getCurrentAccount() const;
+    // 所有已配置的账户，每个账户都在后台同步
+    QList<EmailAccount> getAccounts() const { return accounts; }
 
 signals:
     void accountChanged(const QString &email);
+    // 添加或删除了账户
+    void accountsChanged();
 
 private slots:
     void onAddAccountClicked();
@@ -0,0 +1,245 @@
+#include "asyncdialog.h"
+#include "tlssessioncache.h"
+
+AsyncRuntime &AsyncRuntime::instance()
+{
+    static AsyncRuntime runtime;
+    return runtime;
+}
+
+AsyncRuntime::AsyncRuntime()
+    : m_work(boost::asio::make_work_guard(m_context))
+    , m_sslContext(boost::asio::ssl::context::tls_client)
+{
+    // 与 mailio 的默认设置一致，不校验服务器证书
+    m_sslContext.set_verify_mode(boost::asio::ssl::verify_none);
+    // 重新连接时复用 TLS 会话，省去完整握手
+    TlsSessionCache::instance().attach(m_sslContext.native_handle());
+
+    for (int i = 0; i < kThreadCount; ++i) {
+        m_threads.emplace_back([this]() { m_context.run(); });
+    }
+}
+
+AsyncRuntime::~AsyncRuntime()
+{
+    m_work.reset();
+    m_context.stop();
+    for (std::thread &thread : m_threads) {
+        thread.join();
+    }
+}
+
+std::shared_ptr<AsyncDialog> AsyncDialog::create(AsyncRuntime &runtime)
+{
+    return create(boost::asio::make_strand(runtime.context()), runtime);
+}
+
+std::shared_ptr<AsyncDialog> AsyncDialog::create(const Strand &strand, AsyncRuntime &runtime)
+{
+    return std::shared_ptr<AsyncDialog>(new AsyncDialog(strand, runtime));
+}
+
+AsyncDialog::AsyncDialog(const Strand &strand, AsyncRuntime &runtime)
+    : m_strand(strand)
+    , m_resolver(m_strand)
+    , m_stream(m_strand, runtime.sslContext())
+    , m_timer(m_strand)
+{
+}
+
+void AsyncDialog::armTimer()
+{
+    ++m_timerGeneration;
+    if (m_timeout.count() == 0) {
+        m_timer.cancel();
+        return;
+    }
+
+    const unsigned generation = m_timerGeneration;
+    m_timer.expires_after(m_timeout);
+    m_timer.async_wait([self = shared_from_this(), generation](const boost::system::error_code &error) {
+        if (!error && generation == self->m_timerGeneration) {
+            boost::system::error_code ignored;
+            self->m_stream.next_layer().close(ignored);
+            if (self->m_race) {
+                self->m_race->cancel();
+            }
+        }
+    });
+}
+
+void AsyncDialog::cancelTimer()
+{
+    ++m_timerGeneration;
+    m_timer.cancel();
+}
+
+void AsyncDialog::connect(const std::string &host, unsigned short port, Handler handler)
+{
+    m_sessionKey = host + ":" + std::to_string(port);
+    armTimer();
+
+    HostResolver::Endpoints endpoints;
+    if (HostResolver::instance().lookup(host, port, endpoints)) {
+        race(host, std::move(endpoints), std::move(handler));
+        return;
+    }
+    m_resolver.async_resolve(host, std::to_string(port),
+        [self = shared_from_this(), host, port, handler = std::move(handler)](const boost::system::error_code &error,
+                                                                              boost::asio::ip::tcp::resolver::results_type results) {
+            if (error) {
+                self->cancelTimer();
+                handler(error);
+                return;
+            }
+            self->race(host, HostResolver::instance().store(host, port, results), handler);
+        });
+}
+
+void AsyncDialog::race(const std::string &host, HostResolver::Endpoints endpoints, Handler handler)
+{
+    m_race = ConnectRace::start(m_strand, std::move(endpoints),
+        [self = shared_from_this(), host, handler = std::move(handler)](const boost::system::error_code &error,
+                                                                        boost::asio::ip::tcp::socket socket,
+                                                                        const boost::asio::ip::tcp::endpoint &endpoint) {
+            self->m_race.reset();
+            self->cancelTimer();
+            if (error) {
+                HostResolver::instance().invalidate(host);
+                handler(error);
+                return;
+            }
+            self->m_stream.next_layer() = std::move(socket);
+            HostResolver::instance().connected(host, endpoint.address());
+            handler(error);
+        });
+}
+
+void AsyncDialog::startTls(const std::string &host, Handler handler)
+{
+    // SNI，多个域名共用地址的服务器需要它选择证书
+    SSL_set_tlsext_host_name(m_stream.native_handle(), host.c_str());
+    TlsSessionCache::instance().prepare(m_stream.native_handle(), &m_sessionKey);
+
+    armTimer();
+    m_stream.async_handshake(boost::asio::ssl::stream_base::client,
+        [self = shared_from_this(), handler = std::move(handler)](const boost::system::error_code &error) {
+            self->cancelTimer();
+            TlsSessionCache::instance().completed(self->m_stream.native_handle(), !error);
+            if (!error) {
+                self->m_tls = true;
+            }
+            handler(error);
+        });
+}
+
+void AsyncDialog::sendLine(std::string line, Handler handler)
+{
+    line += "\r\n";
+    m_writes.push_back({std::move(line), std::move(handler)});
+    if (m_writes.size() == 1) {
+        writeNext();
+    }
+}
+
+void AsyncDialog::writeNext()
+{
+    withStream([this](auto &stream) {
+        boost::asio::async_write(stream, boost::asio::buffer(m_writes.front().data),
+            [self = shared_from_this()](const boost::system::error_code &error, std::size_t) {
+                Handler handler = std::move(self->m_writes.front().handler);
+                self->m_writes.pop_front();
+                if (error) {
+                    // 连接已不可用，后面排队的写入一并失败
+                    std::deque<PendingWrite> pending;
+                    pending.swap(self->m_writes);
+                    for (PendingWrite &write : pending) {
+                        if (write.handler) {
+                            write.handler(error);
+                        }
+                    }
+                } else if (!self->m_writes.empty()) {
+                    self->writeNext();
+                }
+                if (handler) {
+                    handler(error);
+                }
+            });
+    });
+}
+
+std::string AsyncDialog::takeBuffered(std::size_t size)
+{
+    const char *data = static_cast<const char *>(m_buffer.data().data());
+    std::string result(data, data + size);
+    m_buffer.consume(size);
+    return result;
+}
+
+void AsyncDialog::readLine(LineHandler handler)
+{
+    armTimer();
+    withStream([this, &handler](auto &stream) {
+        boost::asio::async_read_until(stream, m_buffer, "\r\n",
+            [self = shared_from_this(), handler = std::move(handler)](const boost::system::error_code &error,
+                                                                      std::size_t size) {
+                self->cancelTimer();
+                if (error) {
+                    handler(error, std::string());
+                    return;
+                }
+                std::string line = self->takeBuffered(size);
+                line.resize(line.size() - 2);
+                handler(error, std::move(line));
+            });
+    });
+}
+
+void AsyncDialog::readLiteral(std::size_t size, LineHandler handler)
+{
+    if (m_buffer.size() >= size) {
+        // 数据已经在缓冲区中，仍然异步回调，保持调用顺序一致
+        boost::asio::post(m_strand, [self = shared_from_this(), size, handler = std::move(handler)]() {
+            handler(boost::system::error_code(), self->takeBuffered(size));
+        });
+        return;
+    }
+
+    armTimer();
+    withStream([this, size, &handler](auto &stream) {
+        boost::asio::async_read(stream, m_buffer, boost::asio::transfer_at_least(size - m_buffer.size()),
+            [self = shared_from_this(), size, handler = std::move(handler)](const boost::system::error_code &error,
+                                                                            std::size_t) {
+                self->cancelTimer();
+                if (error) {
+                    handler(error, std::string());
+                    return;
+                }
+                handler(error, self->takeBuffered(size));
+            });
+    });
+}
+
+void AsyncDialog::close()
+{
+    post([self = shared_from_this()]() {
+        if (self->m_closed) {
+            return;
+        }
+        self->m_closed = true;
+        self->cancelTimer();
+        self->m_resolver.cancel();
+        if (self->m_race) {
+            self->m_race->cancel();
+        }
+        boost::system::error_code ignored;
+        self->m_stream.next_layer().shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+        self->m_stream.next_layer().close(ignored);
+    });
+}
+
+void AsyncDialog::post(std::function<void()> function)
+{
+    boost::asio::post(m_strand, std::move(function));
+}
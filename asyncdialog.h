@@ -0,0 +1,118 @@
+#ifndef ASYNCDIALOG_H
+#define ASYNCDIALOG_H
+
+#include <string>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include "hostresolver.h"
+
+/*
+ * 异步的按行收发连接
+ *
+ * mailio::dialog 所有连接共用一个静态 io_context，每次读写都阻塞调用线程等待完成，
+ * 一个长连接就要占住一个线程。AsyncDialog 的每个连接拥有自己的 strand，
+ * 所有连接共享 AsyncRuntime 的少量线程，读写都以回调的形式完成。
+ *
+ * 除 close() 和 post() 外，方法都必须在该连接的 strand 上调用（即在回调中或 post() 之后），
+ * 回调也总在 strand 上执行，同一连接内不需要加锁。
+ */
+class AsyncRuntime
+{
+public:
+    static AsyncRuntime &instance();
+
+    boost::asio::io_context &context() { return m_context; }
+    // 所有连接共用的 TLS 配置
+    boost::asio::ssl::context &sslContext() { return m_sslContext; }
+
+    AsyncRuntime(const AsyncRuntime&) = delete;
+    AsyncRuntime& operator=(const AsyncRuntime&) = delete;
+
+private:
+    static const int kThreadCount = 2;
+
+    AsyncRuntime();
+    ~AsyncRuntime();
+
+    boost::asio::io_context m_context;
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> m_work;
+    boost::asio::ssl::context m_sslContext;
+    std::vector<std::thread> m_threads;
+};
+
+class AsyncDialog : public std::enable_shared_from_this<AsyncDialog>
+{
+public:
+    using Handler = std::function<void(const boost::system::error_code &error)>;
+    // line 不含结尾的 CRLF
+    using LineHandler = std::function<void(const boost::system::error_code &error, std::string line)>;
+    using Strand = boost::asio::strand<boost::asio::io_context::executor_type>;
+
+    static std::shared_ptr<AsyncDialog> create(AsyncRuntime &runtime = AsyncRuntime::instance());
+    // 与已有的 strand 共用，同一对象的多个连接（如断线重连）及其定时器可以不加锁地交替使用
+    static std::shared_ptr<AsyncDialog> create(const Strand &strand, AsyncRuntime &runtime = AsyncRuntime::instance());
+
+    // 解析结果来自 HostResolver 的缓存，多个地址按 RFC 8305 并行尝试（ConnectRace）
+    void connect(const std::string &host, unsigned short port, Handler handler);
+    // 在已建立的 TCP 连接上进行 TLS 握手（直接 TLS 或 STARTTLS 之后），
+    // 同一主机和端口之前的会话会被复用（TlsSessionCache）
+    void startTls(const std::string &host, Handler handler);
+    // 自动追加 CRLF，多次调用按顺序写出
+    void sendLine(std::string line, Handler handler = Handler());
+    void readLine(LineHandler handler);
+    // 读取恰好 size 字节（IMAP 字面量）
+    void readLiteral(std::size_t size, LineHandler handler);
+
+    // 之后每次连接、握手和读操作的超时，超时后连接被关闭，0 表示不限
+    void setTimeout(std::chrono::milliseconds timeout) { m_timeout = timeout; }
+
+    // 可在任意线程调用，未完成的操作以 operation_aborted 之类的错误结束
+    void close();
+    void post(std::function<void()> function);
+    Strand &strand() { return m_strand; }
+
+private:
+    AsyncDialog(const Strand &strand, AsyncRuntime &runtime);
+
+    template<typename Function>
+    void withStream(Function &&function)
+    {
+        if (m_tls) {
+            function(m_stream);
+        } else {
+            function(m_stream.next_layer());
+        }
+    }
+
+    void race(const std::string &host, HostResolver::Endpoints endpoints, Handler handler);
+    void armTimer();
+    void cancelTimer();
+    void writeNext();
+    std::string takeBuffered(std::size_t size);
+
+    struct PendingWrite {
+        std::string data;
+        Handler handler;
+    };
+
+    Strand m_strand;
+    boost::asio::ip::tcp::resolver m_resolver;
+    std::shared_ptr<ConnectRace> m_race;   // 正在进行的并行连接
+    boost::asio::ssl::stream<boost::asio::ip::tcp::socket> m_stream;
+    boost::asio::steady_timer m_timer;
+    boost::asio::streambuf m_buffer;
+    std::deque<PendingWrite> m_writes;
+    std::string m_sessionKey;   // TLS 会话缓存的键 "主机:端口"
+    std::chrono::milliseconds m_timeout{0};
+    unsigned m_timerGeneration = 0;
+    bool m_tls = false;
+    bool m_closed = false;
+};
+
+#endif // ASYNCDIALOG_H
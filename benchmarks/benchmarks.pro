@@ -0,0 +1,7 @@
+# 独立的性能测试程序，不依赖 Qt 和 mailio，单独构建：
+#   qmake benchmarks/benchmarks.pro && make
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    imapresponse \
+    mimecodec
@@ -0,0 +1,12 @@
+# ImapResponse 解析 FETCH 响应的耗时与内存分配次数
+TEMPLATE = app
+TARGET = imapresponse_bench
+
+CONFIG += console c++17
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += \
+    main.cpp \
+    $$PWD/../../imapresponse.cpp
@@ -0,0 +1,143 @@
+#include "imapresponse.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+/*
+ * 测量 ImapResponse 解析 "UID FETCH 1:* (UID BODY.PEEK[HEADER])" 响应的开销
+ *
+ * 用法：imapresponse_bench [邮件数]，默认 100 封。
+ * 替换全局 operator new 统计分配次数，分别报告复用同一个 ImapResponse（会话中的用法）
+ * 和每个响应新建一个对象时，平均每个 FETCH 响应的耗时和分配次数。
+ */
+namespace {
+
+std::atomic<std::size_t> g_allocations{0};
+
+struct Line {
+    std::string text;
+    std::string literal;    // 行尾 {n} 之后的字面量，没有时为空
+};
+
+std::vector<Line> makeFetchResponses(int count)
+{
+    std::vector<Line> lines;
+    for (int i = 1; i <= count; ++i) {
+        std::string header =
+            "Return-Path: <sender" + std::to_string(i) + "@example.com>\r\n"
+            "Received: from mx.example.com (mx.example.com [192.0.2.1])\r\n"
+            "\tby imap.example.org with ESMTPS id " + std::to_string(100000 + i) + "\r\n"
+            "From: \"Sender " + std::to_string(i) + "\" <sender" + std::to_string(i) + "@example.com>\r\n"
+            "To: receiver@example.org\r\n"
+            "Subject: =?UTF-8?B?5rWL6K+V6YKu5Lu2?= #" + std::to_string(i) + "\r\n"
+            "Date: Mon, 5 Feb 2024 10:" + std::to_string(10 + i % 50) + ":00 +0800\r\n"
+            "Message-ID: <" + std::to_string(i) + ".abcdef@example.com>\r\n"
+            "MIME-Version: 1.0\r\n"
+            "Content-Type: multipart/mixed; boundary=\"b" + std::to_string(i) + "\"\r\n"
+            "\r\n";
+        lines.push_back({"* " + std::to_string(i) + " FETCH (UID " + std::to_string(1000 + i)
+                             + " FLAGS (\\Seen) BODY[HEADER] {" + std::to_string(header.size()) + "}",
+                         header});
+        lines.push_back({")", std::string()});
+    }
+    return lines;
+}
+
+// 与 ImapSession::fetchHeaders 相同的取值方式，返回值防止被优化掉
+std::size_t consume(const ImapResponse &response)
+{
+    if (response.size() < 4 || !response.equals(2, "FETCH")) {
+        return 0;
+    }
+    const int uid = response.value(3, "UID");
+    const int header = response.value(3, "BODY[", true);
+    if (uid < 0 || header < 0) {
+        return 0;
+    }
+    return response.number(uid) + response.view(header).size();
+}
+
+std::size_t parse(ImapResponse &response, const std::vector<Line> &lines, std::size_t &i)
+{
+    response.clear();
+    std::size_t literal = 0;
+    while (response.feedLine(lines[i].text, literal)) {
+        response.feedLiteral(lines[i].literal);
+        ++i;
+    }
+    ++i;
+    return consume(response);
+}
+
+void report(const char *name, int responses, int rounds, double seconds, std::size_t allocations)
+{
+    const double total = static_cast<double>(responses) * rounds;
+    std::printf("%-24s %8.0f ns/response %8.2f allocations/response\n", name, seconds * 1e9 / total,
+                allocations / total);
+}
+
+} // namespace
+
+void *operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+int main(int argc, char *argv[])
+{
+    const int count = argc > 1 ? std::atoi(argv[1]) : 100;
+    const int rounds = 200;
+    const std::vector<Line> lines = makeFetchResponses(count);
+    std::size_t sink = 0;
+
+    using Clock = std::chrono::steady_clock;
+    {
+        ImapResponse response;
+        std::size_t i = 0;
+        while (i < lines.size()) {
+            sink += parse(response, lines, i);     // 预热，让缓冲区达到所需容量
+        }
+        const std::size_t before = g_allocations.load();
+        const auto t0 = Clock::now();
+        for (int round = 0; round < rounds; ++round) {
+            for (i = 0; i < lines.size();) {
+                sink += parse(response, lines, i);
+            }
+        }
+        const std::chrono::duration<double> elapsed = Clock::now() - t0;
+        report("reused ImapResponse", count, rounds, elapsed.count(), g_allocations.load() - before);
+    }
+    {
+        const std::size_t before = g_allocations.load();
+        const auto t0 = Clock::now();
+        for (int round = 0; round < rounds; ++round) {
+            for (std::size_t i = 0; i < lines.size();) {
+                ImapResponse response;
+                sink += parse(response, lines, i);
+            }
+        }
+        const std::chrono::duration<double> elapsed = Clock::now() - t0;
+        report("new ImapResponse", count, rounds, elapsed.count(), g_allocations.load() - before);
+    }
+
+    return sink == 0 ? 1 : 0;
+}
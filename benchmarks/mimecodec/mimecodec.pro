@@ -0,0 +1,12 @@
+# Base64 / Quoted-Printable 编解码吞吐量
+TEMPLATE = app
+TARGET = mimecodec_bench
+
+CONFIG += console c++17
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += \
+    main.cpp \
+    $$PWD/../../mimecodec.cpp
@@ -0,0 +1,206 @@
+#include "bulksender.h"
+#include <algorithm>
+#include <random>
+#include <cstdio>
+#include <ctime>
+
+namespace {
+
+std::string rfc5322Date()
+{
+    const std::time_t now = std::time(nullptr);
+    std::tm utc{};
+#if defined(_WIN32)
+    gmtime_s(&utc, &now);
+#else
+    gmtime_r(&now, &utc);
+#endif
+    char buffer[64];
+    std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S +0000", &utc);
+    return buffer;
+}
+
+std::string makeMessageId(const std::string &from)
+{
+    static std::mt19937_64 generator(std::random_device{}());
+    static std::mutex mutex;
+    unsigned long long a, b;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        a = generator();
+        b = generator();
+    }
+    char buffer[40];
+    std::snprintf(buffer, sizeof(buffer), "%016llx.%016llx", a, b);
+    const std::size_t at = from.find('@');
+    return "<" + std::string(buffer) + "@" + (at == std::string::npos ? "localhost" : from.substr(at + 1)) + ">";
+}
+
+} // namespace
+
+BulkSender::BulkSender(SessionFactory factory, Options options)
+    : m_factory(std::move(factory))
+    , m_options(options)
+{
+    m_options.connections = std::max(1, m_options.connections);
+    m_options.messagesPerMinute = std::max(0, m_options.messagesPerMinute);
+}
+
+BulkSender::~BulkSender()
+{
+    cancel();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void BulkSender::start(MimeWriter::Message message, std::vector<std::string> recipients,
+                       ProgressHandler progress, FinishedHandler finished)
+{
+    m_message = std::move(message);
+    m_recipients = std::move(recipients);
+    m_progress = std::move(progress);
+    m_finishedHandler = std::move(finished);
+    m_thread = std::thread([this]() { run(); });
+}
+
+void BulkSender::cancel()
+{
+    m_cancelled.store(true);
+    m_condition.notify_all();
+}
+
+void BulkSender::run()
+{
+    // 正文和附件只编码一次，之后每封邮件只生成自己的头部
+    std::string error;
+    try {
+        MimeWriter writer(m_message, false);
+        for (std::string_view piece = writer.next(); !piece.empty(); piece = writer.next()) {
+            m_body.append(piece.data(), piece.size());
+        }
+    } catch (const std::exception &e) {
+        error = e.what();
+    }
+    m_message.attachments.clear();
+    m_message.body.clear();
+
+    if (!error.empty()) {
+        m_failed = m_recipients.size();
+        for (const std::string &address : m_recipients) {
+            if (m_progress) {
+                m_progress(address, error, 0, m_failed, m_recipients.size());
+            }
+        }
+    } else {
+        m_nextSlot = std::chrono::steady_clock::now();
+        const int workers = std::min<int>(m_options.connections, static_cast<int>(m_recipients.size()));
+        std::vector<std::thread> threads;
+        threads.reserve(static_cast<std::size_t>(workers));
+        for (int i = 0; i < workers; ++i) {
+            threads.emplace_back([this]() { sendLoop(); });
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+
+    m_finished.store(true);
+    if (m_finishedHandler) {
+        m_finishedHandler(m_sent, m_failed, m_cancelled.load());
+    }
+}
+
+bool BulkSender::waitForSlot()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_options.messagesPerMinute == 0) {
+        return !m_cancelled.load();
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto slot = std::max(now, m_nextSlot);
+    m_nextSlot = slot + std::chrono::milliseconds(60000 / m_options.messagesPerMinute);
+    return !m_condition.wait_until(lock, slot, [this]() { return m_cancelled.load(); });
+}
+
+void BulkSender::sendOne(SmtpSession &session, const std::string &address)
+{
+    MimeWriter::Message headers;
+    headers.from = m_message.from;
+    headers.to = {address};
+    headers.subject = m_message.subject;
+    headers.date = rfc5322Date();
+    headers.messageId = makeMessageId(m_message.from);
+    const std::string envelopeHeaders = MimeWriter::envelopeHeaders(headers);
+
+    SmtpSession::Envelope envelope;
+    envelope.from = m_message.from;
+    envelope.recipients = {address};
+
+    // 头部之后直接引用共享的正文，不复制
+    int stage = 0;
+    session.sendMail(envelope, [&]() -> std::string_view {
+        switch (stage++) {
+        case 0:
+            return envelopeHeaders;
+        case 1:
+            return m_body;
+        default:
+            return std::string_view();
+        }
+    });
+}
+
+void BulkSender::sendLoop()
+{
+    std::unique_ptr<SmtpSession> session;
+    while (!m_cancelled.load()) {
+        std::size_t index;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_next >= m_recipients.size()) {
+                break;
+            }
+            index = m_next++;
+        }
+        if (!waitForSlot()) {
+            break;
+        }
+
+        const std::string &address = m_recipients[index];
+        std::string error;
+        // 连接在两次发送之间可能已被服务器关闭，暂时性错误换一个新连接再试一次
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            try {
+                if (!session) {
+                    session = m_factory();
+                }
+                sendOne(*session, address);
+                error.clear();
+                break;
+            } catch (const mailio::smtp_error &e) {
+                error = std::string(e.what()) + (session ? " " + session->lastReplyText() : std::string());
+                if (session && session->lastReplyStatus() >= 500) {
+                    // 永久性拒绝只针对这个收件人，信封已被 RSET，连接继续使用
+                    break;
+                }
+                session.reset();
+            } catch (const std::exception &e) {
+                error = e.what();
+                session.reset();
+            }
+        }
+
+        std::size_t sent, failed;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            (error.empty() ? m_sent : m_failed)++;
+            sent = m_sent;
+            failed = m_failed;
+        }
+        if (m_progress) {
+            m_progress(address, error, sent, failed, m_recipients.size());
+        }
+    }
+}
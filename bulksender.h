@@ -0,0 +1,80 @@
+#ifndef BULKSENDER_H
+#define BULKSENDER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include "smtpsession.h"
+#include "mimewriter.h"
+
+/*
+ * 群发
+ *
+ * 同一封通知分别发给每个收件人，每封邮件只有 To、Message-ID 等头部不同。
+ * 正文和附件只编码一次，所有邮件共享同一份编码结果；
+ * 发送分布在几个各自认证的 SMTP 连接上，总速率受每分钟封数限制。
+ * 回调在发送线程中调用。
+ */
+class BulkSender
+{
+public:
+    struct Options {
+        int connections = 3;           // 同一服务器的并发连接数
+        int messagesPerMinute = 60;    // 所有连接合计，0 表示不限速
+    };
+
+    // 建立并认证一个新连接，失败时抛出异常
+    using SessionFactory = std::function<std::unique_ptr<SmtpSession>()>;
+    // 每个收件人处理完后调用一次，error 为空表示发送成功
+    using ProgressHandler = std::function<void(const std::string &address, const std::string &error,
+                                               std::size_t sent, std::size_t failed, std::size_t total)>;
+    using FinishedHandler = std::function<void(std::size_t sent, std::size_t failed, bool cancelled)>;
+
+    BulkSender(SessionFactory factory, Options options);
+    ~BulkSender();
+
+    BulkSender(const BulkSender&) = delete;
+    BulkSender& operator=(const BulkSender&) = delete;
+
+    // 在后台开始发送后立即返回，message.to 被忽略，每个收件人单独成信。
+    // 每个 BulkSender 只能启动一次
+    void start(MimeWriter::Message message, std::vector<std::string> recipients,
+               ProgressHandler progress, FinishedHandler finished);
+    // 正在发送的邮件完成后停止，不等待
+    void cancel();
+    bool isFinished() const { return m_finished.load(); }
+
+private:
+    void run();
+    void sendLoop();
+    // 按速率限制等待下一个发送时机，取消时返回 false
+    bool waitForSlot();
+    void sendOne(SmtpSession &session, const std::string &address);
+
+    SessionFactory m_factory;
+    Options m_options;
+    ProgressHandler m_progress;
+    FinishedHandler m_finishedHandler;
+
+    MimeWriter::Message m_message;
+    std::vector<std::string> m_recipients;
+    std::string m_body;                 // 共享的已编码正文（MIME 头部之后的全部内容）
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::chrono::steady_clock::time_point m_nextSlot;
+    std::size_t m_next = 0;
+    std::size_t m_sent = 0;
+    std::size_t m_failed = 0;
+    std::atomic<bool> m_cancelled{false};
+    std::atomic<bool> m_finished{false};
+};
+
+#endif // BULKSENDER_H
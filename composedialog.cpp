@@ -147,6 +147,11 @@ Email ComposeDialog::getEmail() const
     return email;
 }
 
+QString ComposeDialog::getRecipients() const
+{
+    return ui->toEdit->text().trimmed();
+}
+
 void ComposeDialog::onAddAttachmentClicked()
 {
     QStringList fileNames = QFileDialog::getOpenFileNames(
@@ -231,16 +236,12 @@ void ComposeDialog::onSendClicked()
         return;
     }
 
-    // 检查附件大小（示例：限制总大小10MB）
-    qint64 totalSize = 0;
+    // 附件在发送时从磁盘流式读取，不再限制总大小，发送前只确认文件仍然存在
     for (const QString &filePath : attachments) {
-        QFileInfo fileInfo(filePath);
-        totalSize += fileInfo.size();
-    }
-
-    if (totalSize > 10 * 1024 * 1024) { // 10MB
-        QMessageBox::warning(this, "附件过大", "附件总大小不能超过10MB");
-        return;
+        if (!QFileInfo::exists(filePath)) {
+            QMessageBox::warning(this, "附件不存在", QString("找不到附件: %1").arg(filePath));
+            return;
+        }
     }
 
     // 发送邮件
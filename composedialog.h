@@ -21,6 +21,8 @@ public:
 
     // 获取邮件内容
     Email getEmail() const;
+    // 收件人，多个地址用逗号或分号分隔
+    QString getRecipients() const;
     bool isHtml() const;
 
 private slots:
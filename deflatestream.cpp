@@ -0,0 +1,92 @@
+#include "deflatestream.h"
+#include <stdexcept>
+#include <cstring>
+
+namespace {
+
+const std::size_t kInputSize = 16 * 1024;
+const int kWindowBits = -15;   // 原始 deflate，不带 zlib 头和校验
+
+} // namespace
+
+DeflateStream::DeflateStream(Source source)
+    : m_source(std::move(source))
+    , m_input(kInputSize)
+    , m_output(kInputSize)
+{
+    std::memset(&m_deflater, 0, sizeof(m_deflater));
+    std::memset(&m_inflater, 0, sizeof(m_inflater));
+    if (deflateInit2(&m_deflater, Z_DEFAULT_COMPRESSION, Z_DEFLATED, kWindowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("Compression initialization failure.");
+    }
+    if (inflateInit2(&m_inflater, kWindowBits) != Z_OK) {
+        deflateEnd(&m_deflater);
+        throw std::runtime_error("Decompression initialization failure.");
+    }
+}
+
+DeflateStream::~DeflateStream()
+{
+    deflateEnd(&m_deflater);
+    inflateEnd(&m_inflater);
+}
+
+std::string_view DeflateStream::deflate(std::string_view data)
+{
+    m_deflater.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    m_deflater.avail_in = static_cast<uInt>(data.size());
+
+    // Z_SYNC_FLUSH 在输出缓冲区还有剩余空间时才算完成
+    std::size_t used = 0;
+    do {
+        if (used == m_output.size()) {
+            m_output.resize(m_output.size() * 2);
+        }
+        m_deflater.next_out = reinterpret_cast<Bytef *>(m_output.data() + used);
+        m_deflater.avail_out = static_cast<uInt>(m_output.size() - used);
+        if (::deflate(&m_deflater, Z_SYNC_FLUSH) == Z_STREAM_ERROR) {
+            throw std::runtime_error("Compression failure.");
+        }
+        used = m_output.size() - m_deflater.avail_out;
+    } while (m_deflater.avail_out == 0);
+
+    return std::string_view(m_output.data(), used);
+}
+
+std::size_t DeflateStream::inflate(char *data, std::size_t size)
+{
+    m_inflater.next_out = reinterpret_cast<Bytef *>(data);
+    m_inflater.avail_out = static_cast<uInt>(size);
+
+    while (true) {
+        if (m_inflater.avail_in == 0) {
+            const std::size_t count = m_source(m_input.data(), m_input.size());
+            m_inflater.next_in = reinterpret_cast<Bytef *>(m_input.data());
+            m_inflater.avail_in = static_cast<uInt>(count);
+        }
+
+        // Z_BUF_ERROR 只表示这次没有进展，需要更多输入
+        const int result = ::inflate(&m_inflater, Z_SYNC_FLUSH);
+        if (result != Z_OK && result != Z_BUF_ERROR) {
+            throw std::runtime_error(result == Z_STREAM_END ? "Compressed stream ended." : "Decompression failure.");
+        }
+        const std::size_t produced = size - m_inflater.avail_out;
+        if (produced > 0) {
+            return produced;
+        }
+    }
+}
+
+void DeflateStream::pushCompressed(std::string_view data)
+{
+    if (data.empty()) {
+        return;
+    }
+    // 只在开始解压前调用，此时输入缓冲区为空
+    if (m_input.size() < data.size()) {
+        m_input.resize(data.size());
+    }
+    std::memcpy(m_input.data(), data.data(), data.size());
+    m_inflater.next_in = reinterpret_cast<Bytef *>(m_input.data());
+    m_inflater.avail_in = static_cast<uInt>(data.size());
+}
@@ -0,0 +1,46 @@
+#ifndef DEFLATESTREAM_H
+#define DEFLATESTREAM_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <cstddef>
+#include <zlib.h>
+
+/*
+ * RFC 4978 COMPRESS=DEFLATE 的压缩层
+ *
+ * 两个方向各是一条不带 zlib 头的原始 deflate 流（windowBits = -15），贯穿整个连接。
+ * 发送的每条命令以 Z_SYNC_FLUSH 结束，服务器马上就能解压出完整的命令；
+ * 接收方向按需从 source 读取压缩数据，解压结果可直接作为 LineReader 的数据源。
+ * TLS 在压缩层之下，source 读取的是 TLS 解密后的数据。
+ */
+class DeflateStream
+{
+public:
+    // 与 LineReader::Source 相同：至少读入 1 个字节，出错时抛出异常
+    using Source = std::function<std::size_t(char *data, std::size_t size)>;
+
+    explicit DeflateStream(Source source);
+    ~DeflateStream();
+
+    DeflateStream(const DeflateStream&) = delete;
+    DeflateStream& operator=(const DeflateStream&) = delete;
+
+    // 压缩并刷新，返回的数据在下一次调用前有效
+    std::string_view deflate(std::string_view data);
+    // 解压出至少 1 个字节，写入 data 并返回字节数
+    std::size_t inflate(char *data, std::size_t size);
+    // 开始压缩前已经读入的压缩数据，先于 source 解压
+    void pushCompressed(std::string_view data);
+
+private:
+    Source m_source;
+    z_stream m_deflater;
+    z_stream m_inflater;
+    std::vector<char> m_input;
+    std::vector<char> m_output;
+};
+
+#endif // DEFLATESTREAM_H
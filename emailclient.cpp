@@ -3,27 +3,491 @@
 #include <QDateTime>
 #include <QFile>
 #include <QFileInfo>
-#include <QtConcurrent/QtConcurrent>
+#include <QSaveFile>
+#include <QUuid>
+#include <algorithm>
+#include <QStringDecoder>
+#include <QRegularExpression>
+#include <QDeadlineTimer>
+#include <QMimeDatabase>
+#include <chrono>
+#include <limits>
+#include "mimecodec.h"
+#include "mimewriter.h"
+#include "tlssessioncache.h"
+#include "hostresolver.h"
+#include "linereader.h"
+
+namespace {
+
+// mailio 的连接直接使用解析缓存给出的地址；连接失败时丢弃缓存，下次重新解析
+template<typename Session, typename... Args>
+std::unique_ptr<Session> connectSession(const QString &host, int port, Args&&... args)
+{
+    const std::string name = host.toStdString();
+    try {
+        return std::make_unique<Session>(HostResolver::instance().address(name, static_cast<unsigned short>(port)),
+                                         port, std::forward<Args>(args)...);
+    } catch (...) {
+        HostResolver::instance().invalidate(name);
+        throw;
+    }
+}
+
+// IMAP 主连接和 IDLE 连接共用的加密设置。"ssl" 对应 mailio 的 start_tls(true)，
+// 即明文连接后用 STARTTLS 升级，与端口无关
+bool imapUsesTls(const EmailAccount &account)
+{
+    return account.imapEncryption == "ssl";
+}
+
+// 按邮件声明的字符集解码，未知字符集按 UTF-8 处理
+QString decodeText(const std::string &bytes, const std::string &charset)
+{
+    if (!charset.empty() && charset != "utf-8" && charset != "us-ascii") {
+        QStringDecoder decoder(charset.c_str());
+        if (decoder.isValid()) {
+            return decoder.decode(QByteArrayView(bytes.data(), static_cast<qsizetype>(bytes.size())));
+        }
+    }
+    return QString::fromUtf8(bytes.data(), static_cast<qsizetype>(bytes.size()));
+}
+
+// RFC 2047 编码字，如 =?GB2312?B?...?=
+QString decodeEncodedWords(const std::string &text)
+{
+    static const QRegularExpression word(R"(=\?([^?]+)\?([BbQq])\?([^?]*)\?=)");
+    const QString input = QString::fromUtf8(text.data(), static_cast<qsizetype>(text.size()));
+
+    QString result;
+    qsizetype last = 0;
+    bool previousWasWord = false;
+    auto it = word.globalMatch(input);
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        const QString between = input.mid(last, match.capturedStart() - last);
+        // 相邻编码字之间的空白不显示
+        if (!(previousWasWord && between.trimmed().isEmpty())) {
+            result += between;
+        }
+
+        const std::string encoded = match.captured(3).toStdString();
+        std::string decoded;
+        if (match.captured(2).compare("B", Qt::CaseInsensitive) == 0) {
+            decoded = MimeCodec::base64Decode(encoded);
+        } else {
+            std::string qp = encoded;
+            std::replace(qp.begin(), qp.end(), '_', ' ');
+            decoded = MimeCodec::quotedPrintableDecode(qp);
+        }
+        result += decodeText(decoded, match.captured(1).toLower().toStdString());
+
+        last = match.capturedEnd();
+        previousWasWord = true;
+    }
+    result += input.mid(last);
+    return result;
+}
+
+// 附件名：RFC 2231 形式的按其声明的字符集解码，其他按 RFC 2047 编码字解码
+QString attachmentName(const std::string &name, const std::string &charset)
+{
+    return charset.empty() ? decodeEncodedWords(name) : decodeText(name, charset);
+}
+
+} // namespace
 
 EmailClient::EmailClient(QObject *parent) : QObject(parent)
     , m_connected(false)
     , m_timeoutTimer(new QTimer(this))
     , m_workerThread(new QThread(this))
+    , m_quit(false)
+    , m_fetchBatchSize(50)
+    , m_store(nullptr)
+    , m_outbox(nullptr)
+    , m_networkBudget(nullptr)
 {
     // 设置超时定时器
     m_timeoutTimer->setSingleShot(true);
     connect(m_timeoutTimer, &QTimer::timeout, this, &EmailClient::onTimeout);
+
+    // 所有网络操作都在工作线程中按顺序执行
+    connect(m_workerThread, &QThread::started, this, [this]() { workerLoop(); }, Qt::DirectConnection);
+    m_workerThread->start();
 }
 
 EmailClient::~EmailClient()
 {
-    disconnectFromServer();
+    {
+        QMutexLocker locker(&m_bulkMutex);
+        m_bulk.reset();
+    }
+    {
+        QMutexLocker locker(&m_queueMutex);
+        m_quit = true;
+    }
+    m_cancel.store(true);
+    {
+        QMutexLocker locker(&m_connectionMutex);
+        m_connectionAborted = true;
+        // 工作线程可能正阻塞在这个连接的读取上，DialogIo::shutdown() 只对原生句柄做系统调用，
+        // 不触碰 Asio 的 socket 对象，可以从 GUI 线程调用
+        if (const auto connection = m_connection.lock()) {
+            DialogIo::shutdown(*connection);
+        }
+    }
+    m_queueCondition.wakeAll();
+    m_workerThread->quit();
+    m_workerThread->wait();
 }
 
 void EmailClient::connectToServer(const EmailAccount &account)
 {
-    // 启动超时定时器（3秒超时，更快响应）
-    m_timeoutTimer->start(3000);
+    enqueue(Command{Command::Connect, account, Email()});
+}
+
+void EmailClient::disconnectFromServer()
+{
+    enqueue(Command{Command::Disconnect, EmailAccount(), Email()});
+}
+
+void EmailClient::fetchEmails()
+{
+    enqueue(Command{Command::Sync, EmailAccount(), Email()});
+}
+
+void EmailClient::fetchEmailBody(const Email &email)
+{
+    enqueue(Command{Command::FetchBody, EmailAccount(), email});
+}
+
+void EmailClient::saveAttachment(const Email &email, int index, const QString &path)
+{
+    enqueue(Command{Command::SaveAttachment, EmailAccount(), email, index, path});
+}
+
+void EmailClient::flushOutbox()
+{
+    enqueue(Command{Command::FlushOutbox, EmailAccount(), Email()});
+}
+
+void EmailClient::prepareSmtp()
+{
+    if (m_smtpWarmUp.load()) {
+        enqueue(Command{Command::WarmUpSmtp, EmailAccount(), Email()});
+    }
+}
+
+void EmailClient::cancelPending()
+{
+    QMutexLocker locker(&m_queueMutex);
+    m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(), [](const Command &command) {
+        return command.type == Command::Sync || command.type == Command::FetchBody
+            || command.type == Command::SaveAttachment;
+    }), m_queue.end());
+    m_cancel.store(true);
+}
+
+bool EmailClient::sendBulk(const EmailAccount &account, const QString &subject, const QString &body, bool html,
+                           const QStringList &attachments, const QStringList &recipients)
+{
+    QMutexLocker locker(&m_bulkMutex);
+    if (m_bulk && !m_bulk->isFinished()) {
+        return false;
+    }
+    m_bulk.reset();
+
+    MimeWriter::Message message;
+    message.from = account.email.toStdString();
+    message.subject = subject.toStdString();
+    message.body = body.toStdString();
+    message.html = html;
+
+    QMimeDatabase mimeDatabase;
+    for (const QString &filePath : attachments) {
+        auto file = std::make_shared<QFile>(filePath);
+        if (!file->open(QIODevice::ReadOnly)) {
+            emit errorOccurred(QString("无法读取附件 %1: %2").arg(filePath, file->errorString()));
+            return false;
+        }
+        message.attachments.push_back({
+            QFileInfo(filePath).fileName().toStdString(),
+            mimeDatabase.mimeTypeForFile(filePath).name().toStdString(),
+            [file](char *buffer, std::size_t size) -> std::size_t {
+                const qint64 count = file->read(buffer, static_cast<qint64>(size));
+                if (count < 0) {
+                    throw std::runtime_error(file->errorString().toStdString());
+                }
+                return static_cast<std::size_t>(count);
+            }
+        });
+    }
+
+    std::vector<std::string> addresses;
+    addresses.reserve(recipients.size());
+    for (const QString &recipient : recipients) {
+        const QString address = recipient.trimmed();
+        if (!address.isEmpty()) {
+            addresses.push_back(address.toStdString());
+        }
+    }
+
+    m_bulk = std::make_unique<BulkSender>([account]() { return openSmtpSession(account); }, m_bulkOptions);
+    m_bulk->start(std::move(message), std::move(addresses),
+        [this](const std::string &address, const std::string &error,
+               std::size_t sent, std::size_t failed, std::size_t total) {
+            if (!error.empty()) {
+                emit bulkRecipientFailed(QString::fromStdString(address), QString::fromStdString(error));
+            }
+            emit bulkProgress(static_cast<int>(sent), static_cast<int>(failed), static_cast<int>(total));
+        },
+        [this](std::size_t sent, std::size_t failed, bool cancelled) {
+            qDebug() << "群发结束 - 成功:" << sent << "失败:" << failed << (cancelled ? "（已取消）" : "");
+            emit bulkFinished(static_cast<int>(sent), static_cast<int>(failed), cancelled);
+        });
+    return true;
+}
+
+void EmailClient::cancelBulk()
+{
+    QMutexLocker locker(&m_bulkMutex);
+    if (m_bulk) {
+        m_bulk->cancel();
+    }
+}
+
+void EmailClient::setBulkLimits(int connections, int messagesPerMinute)
+{
+    QMutexLocker locker(&m_bulkMutex);
+    m_bulkOptions.connections = std::max(1, connections);
+    m_bulkOptions.messagesPerMinute = std::max(0, messagesPerMinute);
+}
+
+void EmailClient::enqueue(Command command)
+{
+    QMutexLocker locker(&m_queueMutex);
+    switch (command.type) {
+    case Command::Sync:
+    case Command::FlushOutbox:
+    case Command::WarmUpSmtp:
+        // 还没开始执行的同步会拿到同样的结果
+        for (const Command &queued : m_queue) {
+            if (queued.type == command.type) {
+                return;
+            }
+        }
+        break;
+    case Command::FetchBody:
+        for (const Command &queued : m_queue) {
+            if (queued.type == Command::FetchBody && queued.email.id == command.email.id) {
+                return;
+            }
+        }
+        break;
+    case Command::SaveAttachment:
+        for (const Command &queued : m_queue) {
+            if (queued.type == Command::SaveAttachment && queued.email.id == command.email.id
+                && queued.attachment == command.attachment && queued.path == command.path) {
+                return;
+            }
+        }
+        break;
+    case Command::Connect:
+    case Command::Disconnect:
+        // 针对旧连接排队的命令已经没有意义
+        m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(),
+            [](const Command &queued) { return queued.type != Command::FlushOutbox; }), m_queue.end());
+        break;
+    }
+    m_queue.push_back(std::move(command));
+    m_queueCondition.wakeOne();
+}
+
+void EmailClient::workerLoop()
+{
+    while (true) {
+        Command command;
+        {
+            QMutexLocker locker(&m_queueMutex);
+            while (m_queue.empty() && !m_quit) {
+                // 没有命令时等到下一个定时任务到期
+                const qint64 wait = nextTimerMsecs();
+                if (wait < 0) {
+                    m_queueCondition.wait(&m_queueMutex);
+                } else if (wait > 0) {
+                    m_queueCondition.wait(&m_queueMutex, QDeadlineTimer(wait));
+                } else {
+                    locker.unlock();
+                    if (acquireBudget()) {
+                        runTimers();
+                        releaseBudget();
+                    }
+                    locker.relock();
+                }
+            }
+            // 未发送的邮件留在发件箱中，下次启动后继续
+            if (m_quit) {
+                break;
+            }
+            command = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_cancel.store(false);
+        }
+        // 与其他账户共享网络并发额度，等待期间仍响应退出
+        if (!acquireBudget()) {
+            break;
+        }
+        execute(command);
+        releaseBudget();
+    }
+
+    // 协议对象在创建它们的线程中释放
+    doDisconnect();
+}
+
+bool EmailClient::acquireBudget()
+{
+    if (!m_networkBudget) {
+        return true;
+    }
+    while (!m_networkBudget->tryAcquire(1, 100)) {
+        QMutexLocker locker(&m_queueMutex);
+        if (m_quit) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void EmailClient::releaseBudget()
+{
+    if (m_networkBudget) {
+        m_networkBudget->release();
+    }
+}
+
+void EmailClient::execute(const Command &command)
+{
+    switch (command.type) {
+    case Command::Connect:
+        doConnect(command.account);
+        break;
+    case Command::Disconnect:
+        doDisconnect();
+        break;
+    case Command::Sync:
+        doFetchEmails();
+        break;
+    case Command::FetchBody:
+        doFetchEmailBody(command.email);
+        break;
+    case Command::SaveAttachment:
+        doSaveAttachment(command.email, command.attachment, command.path);
+        break;
+    case Command::FlushOutbox:
+        // 用户主动发送时不再等待上次失败的退避时间
+        m_outboxHold = QDateTime();
+        drainOutbox();
+        break;
+    case Command::WarmUpSmtp:
+        // 失败不提示，发送时还会重试连接并由发件箱记录错误
+        if (acquireSmtp()) {
+            // 撰写期间不被空闲超时关闭
+            m_smtpLastUsed = std::chrono::steady_clock::now();
+        } else {
+            qDebug() << "SMTP 预连接失败:" << m_lastError;
+        }
+        break;
+    }
+}
+
+qint64 EmailClient::nextTimerMsecs() const
+{
+    qint64 result = -1;
+    if (m_smtp && m_smtpIdleTimeout.load() > 0) {
+        result = smtpIdleRemaining();
+    }
+    const qint64 due = outboxDueMsecs();
+    if (due >= 0 && (result < 0 || due < result)) {
+        result = due;
+    }
+    return result;
+}
+
+qint64 EmailClient::outboxDueMsecs() const
+{
+    if (!m_outbox || m_currentAccount.email.isEmpty()) {
+        return -1;
+    }
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    const qint64 due = m_outbox->msecsUntilDue(m_currentAccount.email, now);
+    if (due < 0 || !m_outboxHold.isValid()) {
+        return due;
+    }
+    return std::max(due, now.msecsTo(m_outboxHold));
+}
+
+void EmailClient::runTimers()
+{
+    if (outboxDueMsecs() == 0) {
+        drainOutbox();
+    }
+    if (m_smtp && m_smtpIdleTimeout.load() > 0 && smtpIdleRemaining() == 0) {
+        qDebug() << "SMTP 连接空闲超时，关闭连接";
+        m_smtp.reset();
+    }
+}
+
+void EmailClient::drainOutbox()
+{
+    if (!m_outbox) {
+        return;
+    }
+
+    Outbox::Entry entry;
+    while (m_outbox->takeDue(m_currentAccount.email, QDateTime::currentDateTimeUtc(), entry)) {
+        emit outboxStateChanged(entry.emailId, Outbox::Sending, QString());
+
+        QString error;
+        bool permanent = false;
+        QStringList rejected;
+        if (sendSmtpEmail(entry, error, permanent, rejected)) {
+            m_outbox->markSent(entry.id);
+            // 部分收件人被拒绝时邮件仍已发给其他人，不重试，只报告被拒绝的地址
+            const QString note = rejected.isEmpty() ? QString()
+                                                    : QString("以下收件人被拒绝: %1").arg(rejected.join("; "));
+            emit outboxStateChanged(entry.emailId, Outbox::Sent, note);
+            if (!note.isEmpty()) {
+                emit errorOccurred(QString("邮件「%1」%2").arg(entry.subject, note));
+            }
+            qDebug() << "✅ 邮件已发送:" << entry.subject;
+        } else if (permanent) {
+            m_outbox->markFailed(entry.id, error);
+            emit outboxStateChanged(entry.emailId, Outbox::Failed, error);
+            emit errorOccurred(QString("邮件发送失败: %1").arg(error));
+        } else {
+            // 网络或服务器暂时不可用时其余邮件也会失败，一起推迟到下次重试
+            m_outboxHold = m_outbox->markRetry(entry.id, error);
+            emit outboxStateChanged(entry.emailId, Outbox::Retrying, error);
+            qDebug() << "邮件发送暂时失败，稍后重试:" << error;
+            break;
+        }
+    }
+}
+
+void EmailClient::doConnect(const EmailAccount &account)
+{
+    // 启动超时定时器（3秒超时，更快响应），定时器属于 GUI 线程
+    QMetaObject::invokeMethod(m_timeoutTimer, [this]() { m_timeoutTimer->start(3000); }, Qt::QueuedConnection);
+    stopIdle();
+    if (account.email != m_currentAccount.email) {
+        m_folderStates.clear();
+        m_pop3Seen.clear();
+        m_pop3SeenLoaded = false;
+        // 换账户后旧的 SMTP 连接不能再用
+        m_smtp.reset();
+        m_outboxHold = QDateTime();
+    }
     m_currentAccount = account;
     m_connected = false;
 
@@ -43,6 +507,9 @@ void EmailClient::connectToServer(const EmailAccount &account)
 
     if (success) {
         m_connected = true;
+        if (account.protocol == "imap") {
+            startIdle();
+        }
         emit connectionStatusChanged(true);
         qDebug() << "✅ 成功连接到邮件服务器";
     } else {
@@ -51,18 +518,20 @@ void EmailClient::connectToServer(const EmailAccount &account)
     }
 
     // 停止超时定时器
-    m_timeoutTimer->stop();
+    QMetaObject::invokeMethod(m_timeoutTimer, [this]() { m_timeoutTimer->stop(); }, Qt::QueuedConnection);
 }
 
 bool EmailClient::connectImapServer()
 {
     try {
         // 创建 imap 对象作为成员变量使用
-        m_imap = std::make_unique<mailio::imap>(m_currentAccount.imapServer.toStdString(),
-                                               m_currentAccount.imapPort);
+        m_selectedFolder.clear();
+        m_selectionSynced = false;
+        m_imap = connectSession<ImapSession>(m_currentAccount.imapServer, m_currentAccount.imapPort);
+        trackConnection(m_imap->connection());
 
         // 设置SSL/TLS
-        if (m_currentAccount.imapEncryption == "ssl") {
+        if (imapUsesTls(m_currentAccount)) {
             m_imap->start_tls(true);
         }
 
@@ -71,6 +540,11 @@ bool EmailClient::connectImapServer()
                             m_currentAccount.password.toStdString(),
                             mailio::imap::auth_method_t::LOGIN);
 
+        // 服务器支持时压缩此后的全部流量，文本邮件通常能省下一大半
+        if (m_imap->compress()) {
+            qDebug() << "IMAP 已开启 COMPRESS=DEFLATE";
+        }
+
         return true;
     } catch (const std::exception& e) {
         emit errorOccurred(QString("IMAP连接失败: %1").arg(e.what()));
@@ -82,8 +556,8 @@ bool EmailClient::connectPop3Server()
 {
     try {
         // 创建 pop3 对象作为成员变量使用
-        m_pop3 = std::make_unique<mailio::pop3>(m_currentAccount.imapServer.toStdString(),
-                                               m_currentAccount.imapPort);
+        m_pop3 = connectSession<Pop3Session>(m_currentAccount.imapServer, m_currentAccount.imapPort);
+        trackConnection(m_pop3->connection());
 
         // 设置SSL/TLS
         if (m_currentAccount.imapEncryption == "ssl") {
@@ -94,6 +568,9 @@ bool EmailClient::connectPop3Server()
         m_pop3->authenticate(m_currentAccount.email.toStdString(),
                             m_currentAccount.password.toStdString(),
                             mailio::pop3::auth_method_t::LOGIN);
+        // 邮件序号只在本次会话中有效
+        m_pop3Numbers.clear();
+        m_pop3Removed = false;
 
         return true;
     } catch (const std::exception& e) {
@@ -102,10 +579,37 @@ bool EmailClient::connectPop3Server()
     }
 }
 
-void EmailClient::disconnectFromServer()
+void EmailClient::trackConnection(const std::weak_ptr<mailio::dialog> &connection)
+{
+    QMutexLocker locker(&m_connectionMutex);
+    m_connection = connection;
+    if (m_connectionAborted) {
+        if (const auto dialog = connection.lock()) {
+            DialogIo::shutdown(*dialog);
+        }
+    }
+}
+
+void EmailClient::dropPop3Session()
+{
+    if (!m_pop3) {
+        return;
+    }
+    // 不发送 QUIT，本会话中的删除不会提交
+    if (const auto connection = m_pop3->connection().lock()) {
+        DialogIo::shutdown(*connection);
+    }
+    m_pop3.reset();
+    m_pop3Numbers.clear();
+}
+
+void EmailClient::doDisconnect()
 {
     qDebug() << "断开邮件服务器连接...";
+    stopIdle();
     m_connected = false;
+    m_selectedFolder.clear();
+    m_selectionSynced = false;
     m_imap.reset();
     m_pop3.reset();
     m_smtp.reset();
@@ -113,7 +617,78 @@ void EmailClient::disconnectFromServer()
     qDebug() << "已断开邮件服务器连接";
 }
 
-void EmailClient::fetchEmails()
+void EmailClient::startIdle()
+{
+    stopIdle();
+
+    try {
+        if (!m_imap || !m_imap->hasCapability("IDLE")) {
+            qDebug() << "服务器不支持 IDLE，继续使用定时轮询";
+            return;
+        }
+    } catch (const std::exception& e) {
+        qDebug() << "查询服务器能力失败:" << e.what();
+        return;
+    }
+
+    ImapIdleClient::Settings settings;
+    settings.host = m_currentAccount.imapServer.toStdString();
+    settings.port = static_cast<unsigned short>(m_currentAccount.imapPort);
+    // 与主连接按同一设置建立 TLS，不按端口猜测
+    if (imapUsesTls(m_currentAccount)) {
+        settings.security = ImapIdleClient::Settings::StartTls;
+    }
+    settings.user = m_currentAccount.email.toStdString();
+    settings.password = m_currentAccount.password.toStdString();
+    settings.folder = "INBOX";
+
+    m_idleClient = ImapIdleClient::create(settings,
+        [this](const std::string &folder) {
+            emit mailboxChanged(QString::fromStdString(folder));
+        },
+        [this](bool active, const std::string &reason) {
+            if (active) {
+                const TlsSessionCache::Stats tls = TlsSessionCache::instance().stats();
+                qDebug() << "进入 IDLE 状态，TLS 握手复用会话" << tls.resumed << "次，完整握手" << tls.full << "次";
+            } else {
+                qDebug() << "IDLE 连接中断:" << QString::fromStdString(reason);
+            }
+            // 断开期间由定时轮询接管
+            if (m_idleActive.exchange(active) != active) {
+                emit idleStateChanged(active);
+            }
+        });
+    m_idleClient->start();
+}
+
+void EmailClient::stopIdle()
+{
+    if (m_idleClient) {
+        m_idleClient->stop();
+        m_idleClient.reset();
+    }
+    if (m_idleActive.exchange(false)) {
+        emit idleStateChanged(false);
+    }
+}
+
+void EmailClient::recordImapTraffic(const char *operation)
+{
+    if (!m_imap) {
+        return;
+    }
+    const ImapSession::Traffic traffic = m_imap->takeTraffic();
+    const quint64 wire = traffic.wireIn + traffic.wireOut;
+    const quint64 data = traffic.dataIn + traffic.dataOut;
+    m_imapWireBytes += wire;
+    m_imapDataBytes += data;
+    if (data > 0) {
+        qDebug() << "IMAP" << operation << "流量:" << wire << "字节，压缩前" << data << "字节"
+                 << (m_imap->isCompressed() ? "(COMPRESS)" : "");
+    }
+}
+
+void EmailClient::doFetchEmails()
 {
     if (!m_connected) {
         emit errorOccurred("未连接到服务器");
@@ -124,6 +699,7 @@ void EmailClient::fetchEmails()
 
     if (m_currentAccount.protocol == "imap") {
         success = fetchImapEmails();
+        recordImapTraffic("同步");
     } else {
         success = fetchPop3Emails();
     }
@@ -143,53 +719,134 @@ bool EmailClient::fetchImapEmails()
             return false;
         }
 
-        // 列出文件夹，需要提供文件夹名称
-        auto folders = m_imap->list_folders("INBOX");
-
-        // 获取统计信息，需要提供邮箱名称（注释掉未使用的变量）
-        // auto stats = m_imap->statistics("INBOX");
-
-        // 选择INBOX
-        if (folders.folders.find("INBOX") != folders.folders.end()) {
-            m_imap->select("INBOX");
-
-            // 获取邮件数量 - 修正成员名称
-            auto mailbox_stats = m_imap->statistics("INBOX");
-            int total_messages = mailbox_stats.messages_no;  // 修正为 messages_no
-
-            // 获取最新的几封邮件（避免加载过多）
-            int start_msg = std::max(1, total_messages - 10);
-            for (int i = start_msg; i <= total_messages; ++i) {
-                try {
-                    mailio::message msg;
-                    m_imap->fetch(i, msg);
-
-                    QString from = QString::fromStdString(msg.from_to_string());
-                    QString subject = QString::fromStdString(msg.subject());
-                    QString body = QString::fromStdString(msg.content());
-
-                    // 简化HTML检测逻辑
-                    bool is_html = false; // 暂时简化处理
-
-                    QStringList attachments;
-                    // 简化附件处理 - 修正参数传递
-                    if (msg.attachments_size() > 0) {
-                        for (size_t j = 0; j < msg.attachments_size(); ++j) {
-                            std::ostringstream att_stream;
-                            mailio::string_t att_name;  // 使用正确的类型
-                            msg.attachment(j, att_stream, att_name);
-                            // 修正获取附件名称的方式
-                            attachments << QString::fromStdString(static_cast<std::string>(att_name));
-                        }
+        const QString folder = "INBOX";
+        const std::string mailbox = folder.toStdString();
+        if (!m_folderStates.contains(folder) && m_store) {
+            // 从本地存储恢复上次同步到的位置
+            MailStore::FolderState stored = m_store->folderState(folder);
+            FolderSyncState restored;
+            restored.uidValidity = stored.uidValidity;
+            restored.uidNext = stored.uidNext;
+            restored.lastUid = stored.lastUid;
+            m_folderStates.insert(folder, restored);
+        }
+        FolderSyncState &state = m_folderStates[folder];
+
+        auto checkValidity = [&](unsigned long uidValidity) {
+            if (state.uidValidity != 0 && uidValidity != 0 && uidValidity != state.uidValidity) {
+                // UIDVALIDITY 变化，之前记录的 UID 全部作废，重新全量同步
+                qDebug() << folder << "UIDVALIDITY 变化:" << state.uidValidity << "->" << uidValidity;
+                state = FolderSyncState();
+                emit mailboxReset(folder);
+            }
+        };
+
+        // 判断是否有新邮件，没有变化时不下载任何内容。已选中的文件夹不能用 STATUS
+        // （RFC 3501 6.3.10），改用 NOOP：没有 EXISTS 说明邮件数量没有变化
+        // 同步之外的 SELECT 会让之前到达的新邮件不再以 EXISTS 报告，这时直接重新 SELECT
+        if (m_selectedFolder == folder) {
+            if (m_selectionSynced && state.uidNext != 0 && !m_imap->noop()) {
+                return true;
+            }
+        } else {
+            const auto status = m_imap->status(mailbox);
+            checkValidity(status.uid_validity);
+            // 空文件夹同步过一次后 uidNext 也不为 0，同样跳过
+            if (state.uidNext != 0 && status.uid_next != 0 && status.uid_next == state.uidNext) {
+                return true;
+            }
+        }
+
+        // 有新邮件时才重新 SELECT，让服务器刷新 EXISTS；响应中的 UIDNEXT 是最新的
+        const auto mailbox_stats = m_imap->selectFolder(mailbox);
+        m_selectedFolder = folder;
+        m_selectionSynced = false;
+        checkValidity(mailbox_stats.uid_validity);
+        state.uidValidity = mailbox_stats.uid_validity;
+        if (m_store) {
+            m_store->resetFolder(folder, state.uidValidity);
+        }
+
+        // 首次同步（包括 UIDVALIDITY 变化后的全量同步）下载文件夹中的全部邮件，
+        // 按 UID 升序分批，lastUid 逐批推进，中断后下次从断点继续
+        std::vector<unsigned long> pending;
+        if (state.lastUid == 0) {
+            pending = m_imap->searchUids("ALL");
+        } else {
+            pending = m_imap->searchUids("UID " + std::to_string(state.lastUid + 1) + ":*");
+            // "n:*" 在没有新邮件时仍会返回最后一封，需要过滤
+            pending.erase(std::remove_if(pending.begin(), pending.end(),
+                                         [&state](unsigned long uid) { return uid <= state.lastUid; }),
+                          pending.end());
+        }
+
+        // 按批次发送 UID FETCH，每批只有一次网络往返
+        bool complete = true;
+        size_t batches = 0;
+        size_t received = 0;
+        for (size_t offset = 0; offset < pending.size(); offset += m_fetchBatchSize) {
+            if (m_cancel.load()) {
+                complete = false;
+                break;
+            }
+            const size_t batch_end = std::min(pending.size(), offset + static_cast<size_t>(m_fetchBatchSize));
+            std::vector<unsigned long> batch(pending.begin() + offset, pending.begin() + batch_end);
+
+            std::map<unsigned long, Email> emails;
+            try {
+                // 列表只需要发件人、主题和日期，正文在打开邮件时再下载
+                m_imap->fetchHeaders(toUidSet(batch), [&](unsigned long uid, std::string_view header) {
+                    if (uid <= state.lastUid) {
+                        return;
                     }
+                    MimeView view;
+                    view.feed(header);
+                    view.finish();
+                    Email email = buildEmail(view, MailStore::emailId(folder, state.uidValidity, uid));
+                    email.folder = folder;
+                    email.uid = uid;
+                    email.account = m_currentAccount.email;
+                    emails[uid] = email;
+                });
+            } catch (const std::exception& e) {
+                // 整批失败时不推进 lastUid，下次同步重试
+                qDebug() << "批量获取邮件失败 UID" << batch.front() << "-" << batch.back() << ":" << e.what();
+                complete = false;
+                break;
+            }
 
-                    emit newEmailReceived(from, subject, body, is_html, attachments);
-                } catch (const std::exception& e) {
-                    qDebug() << "获取邮件" << i << "失败:" << e.what();
+            for (const auto &[uid, email] : emails) {
+                if (m_store) {
+                    m_store->appendEmail(email);
                 }
+                emit newEmailReceived(email);
             }
+            state.lastUid = std::max(state.lastUid, batch.back());
+            ++batches;
+            received += emails.size();
         }
 
+        // 有邮件没取到（失败或被取消）时不记录 UIDNEXT，否则下次同步会认为没有变化而跳过，
+        // 保持原值让下次重新 SELECT 并从 lastUid + 1 搜索
+        if (!complete) {
+            return true;
+        }
+        // 每个 UID 都应落在某一批中，lastUid 到达最后一个 UID。
+        // 收到的封数可以少于 UID 数（两次命令之间被删除的邮件服务器不再返回）
+        if (!pending.empty()) {
+            const size_t batchSize = static_cast<size_t>(m_fetchBatchSize);
+            const size_t expected = (pending.size() + batchSize - 1) / batchSize;
+            qDebug() << folder << "同步" << pending.size() << "个 UID，" << batches << "批，收到" << received << "封";
+            if (batches != expected || state.lastUid != pending.back()) {
+                qDebug() << "分批同步未覆盖全部 UID: 应为" << expected << "批，lastUid" << state.lastUid
+                         << "最后的 UID" << pending.back();
+            }
+        }
+        state.uidNext = mailbox_stats.uid_next;
+        if (m_store) {
+            m_store->setUidNext(folder, state.uidNext);
+        }
+        m_selectionSynced = true;
         return true;
     } catch (const std::exception& e) {
         m_lastError = QString::fromStdString(e.what());
@@ -198,154 +855,626 @@ bool EmailClient::fetchImapEmails()
     }
 }
 
+void EmailClient::selectImapFolder(const QString &folder)
+{
+    if (m_selectedFolder != folder) {
+        m_imap->selectFolder(folder.toStdString());
+        m_selectedFolder = folder;
+        m_selectionSynced = false;
+    }
+}
+
+QString EmailClient::pop3SeenPath() const
+{
+    return m_store ? m_store->rootPath() + "/pop3-seen.dat" : QString();
+}
+
 bool EmailClient::fetchPop3Emails()
 {
     try {
-        if (!m_pop3) {
-            emit errorOccurred("POP3连接未建立");
+        if (!m_pop3 && !connectPop3Server()) {
             return false;
         }
+        // 上次同步删除过邮件时重新连接，QUIT 会提交这些删除；否则沿用连接
+        if (m_pop3Removed) {
+            m_pop3.reset();
+            if (!connectPop3Server()) {
+                return false;
+            }
+        }
+
+        if (!m_pop3SeenLoaded) {
+            const QString path = pop3SeenPath();
+            if (!path.isEmpty()) {
+                m_pop3Seen.load(path);
+            }
+            m_pop3SeenLoaded = true;
+        }
 
-        // 获取邮件列表
-        auto message_list = m_pop3->list();
+        // 没有新邮件时整个同步只有这一条 UIDL 命令。
+        // 沿用的连接可能已被服务器因空闲断开（RFC 1939 的自动注销），这时重新连接再试一次
+        mailio::pop3::uidl_list_t uidls;
+        try {
+            uidls = m_pop3->uidl();
+        } catch (const std::exception& e) {
+            qDebug() << "POP3 连接已失效，重新连接:" << e.what();
+            dropPop3Session();
+            if (!connectPop3Server()) {
+                return false;
+            }
+            uidls = m_pop3->uidl();
+        }
+
+        const QString folder = "INBOX";
+        const qint64 now = QDateTime::currentSecsSinceEpoch();
+        const qint64 retention = static_cast<qint64>(m_pop3RetentionDays.load()) * 24 * 3600;
+        bool changed = false;
+
+        std::vector<quint64> present;
+        std::vector<std::pair<unsigned, quint64>> unseen;
+        std::vector<unsigned> expired;
+        present.reserve(uidls.size());
+        m_pop3Numbers.clear();
+        for (const auto &[number, uidl] : uidls) {
+            const quint64 hash = Pop3SeenSet::hash(uidl);
+            present.push_back(hash);
+            // 没有本地 UID 的记录（旧版本首次同步时跳过的邮件）没有下载过，同样要下载。
+            // 保留期限只删除已保存在本地的邮件
+            const Pop3SeenSet::Entry *entry = m_pop3Seen.find(hash);
+            if (entry && entry->uid != 0) {
+                m_pop3Numbers.insert(entry->uid, number);
+                if (retention > 0 && now - entry->seen > retention) {
+                    expired.push_back(number);
+                }
+            } else {
+                unseen.push_back({number, hash});
+            }
+        }
+        // 服务器上已删除的邮件不再记录
+        changed = m_pop3Seen.keepOnly(present) > 0;
+
+        if (!unseen.empty() && m_store) {
+            m_store->resetFolder(folder, kPop3UidValidity);
+        }
+        const quint32 storedUid = m_store ? static_cast<quint32>(m_store->folderState(folder).lastUid) : 0;
+
+        // 支持 PIPELINING 时 TOP 命令流水线发送；分批执行以便及时响应取消
+        QHash<unsigned long, quint64> hashes;
+        std::vector<unsigned long> numbers;
+        for (const auto &[number, hash] : unseen) {
+            hashes.insert(number, hash);
+            numbers.push_back(number);
+        }
+        for (size_t offset = 0; offset < numbers.size() && !m_cancel.load(); offset += kPop3FetchBatch) {
+            const size_t batchEnd = std::min(numbers.size(), offset + kPop3FetchBatch);
+            const std::vector<unsigned long> batch(numbers.begin() + offset, numbers.begin() + batchEnd);
 
-        // 获取最新的几封邮件
-        int count = 0;
-        for (auto it = message_list.rbegin(); it != message_list.rend() && count < 10; ++it, ++count) {
+            std::vector<unsigned long> failed;
             try {
-                mailio::message msg;
-                m_pop3->fetch(it->first, msg);
-
-                QString from = QString::fromStdString(msg.from_to_string());
-                QString subject = QString::fromStdString(msg.subject());
-                QString body = QString::fromStdString(msg.content());
-
-                // 简化HTML检测逻辑
-                bool is_html = false; // 暂时简化处理
-
-                QStringList attachments;
-                // 简化附件处理 - 修正参数传递
-                if (msg.attachments_size() > 0) {
-                    for (size_t j = 0; j < msg.attachments_size(); ++j) {
-                        std::ostringstream att_stream;
-                        mailio::string_t att_name;  // 使用正确的类型
-                        msg.attachment(j, att_stream, att_name);
-                        // 修正获取附件名称的方式
-                        attachments << QString::fromStdString(static_cast<std::string>(att_name));
+                // TOP n 0，只下载邮件头，正文在打开邮件时再下载
+                failed = m_pop3->fetch(batch, true, [&](unsigned long number, std::string_view header) {
+                    MimeView view;
+                    view.feed(header);
+                    view.finish();
+
+                    const quint32 uid = m_pop3Seen.allocateUid(storedUid);
+                    Email email = buildEmail(view, MailStore::emailId(folder, kPop3UidValidity, uid));
+                    email.folder = folder;
+                    email.uid = uid;
+                    email.account = m_currentAccount.email;
+                    if (m_store) {
+                        m_store->appendEmail(email);
                     }
-                }
+                    m_pop3Seen.insert(hashes.value(number), uid, now);
+                    m_pop3Numbers.insert(uid, number);
+                    changed = true;
+                    emit newEmailReceived(email);
+                });
+            } catch (const std::exception& e) {
+                // 已收到的邮件照常记录，其余的下次同步重试
+                qDebug() << "批量获取POP3邮件失败:" << e.what();
+                // 流水线中断后连接上还有未读的响应，不能再用于删除、下载正文或附件
+                expired.clear();
+                dropPop3Session();
+                break;
+            }
+            // 被拒绝的邮件不记为已见，下次同步重试
+            for (unsigned long number : failed) {
+                qDebug() << "获取POP3邮件失败，序号:" << number;
+            }
+        }
 
-                emit newEmailReceived(from, subject, body, is_html, attachments);
+        // 超过保留期限的邮件从服务器删除，QUIT 时生效；记录在邮件从 UIDL 中消失后清除
+        for (unsigned number : expired) {
+            try {
+                m_pop3->remove(number);
+                m_pop3Removed = true;
+                for (auto it = m_pop3Numbers.begin(); it != m_pop3Numbers.end();) {
+                    it = it.value() == number ? m_pop3Numbers.erase(it) : std::next(it);
+                }
             } catch (const std::exception& e) {
-                qDebug() << "获取POP3邮件失败:" << e.what();
+                qDebug() << "删除POP3邮件失败:" << e.what();
             }
         }
 
+        const QString path = pop3SeenPath();
+        if (changed && !path.isEmpty() && !m_pop3Seen.save(path)) {
+            qWarning() << "保存POP3已下载记录失败:" << path;
+        }
         return true;
     } catch (const std::exception& e) {
+        dropPop3Session();
         m_lastError = QString::fromStdString(e.what());
         emit errorOccurred(m_lastError);
         return false;
     }
 }
 
-void EmailClient::sendEmail(const QString &to, const QString &subject,
-                           const QString &body, const QStringList &attachments)
+std::string EmailClient::toUidSet(const std::vector<unsigned long> &uids)
 {
-    // 在新的线程中发送邮件 - 修正 QtConcurrent 警告
-    QFuture<void> future = QtConcurrent::run([this, to, subject, body, attachments]() {
-        bool success = sendSmtpEmail(to, subject, body, attachments);
-        emit emailSent(success);
-    });
-    // 可以选择忽略返回值或者保存 future 以供后续使用
-    Q_UNUSED(future);
+    // 把有序 UID 合并成 "a:b" 区间，缩短命令长度
+    std::string set;
+    for (size_t i = 0; i < uids.size();) {
+        size_t j = i;
+        while (j + 1 < uids.size() && uids[j + 1] == uids[j] + 1) {
+            ++j;
+        }
+        if (!set.empty()) {
+            set += ',';
+        }
+        set += std::to_string(uids[i]);
+        if (j > i) {
+            set += ':' + std::to_string(uids[j]);
+        }
+        i = j + 1;
+    }
+    return set;
 }
 
-bool EmailClient::connectSmtpServer()
+Email EmailClient::buildEmail(const MimeView &header, const QString &id) const
 {
-    try {
-        m_smtp = std::make_unique<mailio::smtp>(m_currentAccount.smtpServer.toStdString(),
-                                               m_currentAccount.smtpPort);
+    Email email;
+    email.id = id;
+    // 显示名两边的引号不显示
+    email.sender = decodeEncodedWords(header.header(0, "From")).remove(QLatin1Char('"')).trimmed();
+    email.subject = decodeEncodedWords(header.header(0, "Subject")).trimmed();
+    email.isHtml = false;
+    email.isRead = false;
+    email.isFavorite = false;
+    email.bodyLoaded = false;
+
+    // 使用邮件头中的日期，缺失时使用接收时间；去掉结尾 "(CST)" 之类的注释
+    email.time = QDateTime::currentDateTime();
+    QString date = QString::fromStdString(header.header(0, "Date"));
+    const qsizetype comment = date.indexOf(QLatin1Char('('));
+    if (comment > 0) {
+        date.truncate(comment);
+    }
+    const QDateTime parsed = QDateTime::fromString(date.trimmed(), Qt::RFC2822Date);
+    if (parsed.isValid()) {
+        email.time = parsed.toLocalTime();
+    }
 
-        if (m_currentAccount.smtpEncryption == "ssl") {
-            m_smtp->start_tls(true);
+    return email;
+}
+
+void EmailClient::fillBody(const MimeView &view, Email &email) const
+{
+    for (int i = 0; i < view.partCount(); ++i) {
+        const MimeView::Part &part = view.part(i);
+        if (view.isMultipart(i)) {
+            continue;
         }
 
-        m_smtp->authenticate(m_currentAccount.email.toStdString(),
-                            m_currentAccount.password.toStdString(),
-                            mailio::smtp::auth_method_t::LOGIN);
+        // 附件只记录名称，正文不解码
+        if (view.isAttachment(i)) {
+            std::string charset;
+            const std::string name = view.fileName(i, &charset);
+            email.attachments << attachmentName(name, charset);
+            continue;
+        }
 
-        return true;
-    } catch (const std::exception& e) {
-        emit errorOccurred(QString("SMTP连接失败: %1").arg(e.what()));
+        if (part.mediaType != "text/plain" && part.mediaType != "text/html") {
+            continue;
+        }
+        bool html = part.mediaType == "text/html";
+        // multipart/alternative 中优先使用 HTML 版本，只解码选中的部分
+        if (email.content.isEmpty() || (html && !email.isHtml)) {
+            email.content = decodeText(view.decodedBody(i), view.charset(i));
+            email.isHtml = html;
+        }
+    }
+}
+
+const ImapSession::BodyPart *EmailClient::fillBody(const std::vector<ImapSession::BodyPart> &parts, Email &email) const
+{
+    const ImapSession::BodyPart *text = nullptr;
+    for (const ImapSession::BodyPart &part : parts) {
+        if (part.attachment) {
+            email.attachments << attachmentName(part.fileName, part.fileNameCharset);
+            continue;
+        }
+        if (part.mediaType != "text/plain" && part.mediaType != "text/html") {
+            continue;
+        }
+        // 与 MimeView 的规则相同，multipart/alternative 中优先使用 HTML 版本
+        if (!text || (part.mediaType == "text/html" && text->mediaType != "text/html")) {
+            text = &part;
+        }
+    }
+    return text;
+}
+
+bool EmailClient::pop3Number(unsigned long uid, unsigned &number)
+{
+    if (m_pop3Numbers.isEmpty()) {
+        for (const auto &[serverNumber, uidl] : m_pop3->uidl()) {
+            if (const Pop3SeenSet::Entry *entry = m_pop3Seen.find(Pop3SeenSet::hash(uidl))) {
+                if (entry->uid != 0) {
+                    m_pop3Numbers.insert(entry->uid, serverNumber);
+                }
+            }
+        }
+    }
+    const auto it = m_pop3Numbers.constFind(static_cast<quint32>(uid));
+    if (it == m_pop3Numbers.constEnd()) {
         return false;
     }
+    number = it.value();
+    return true;
 }
 
-bool EmailClient::sendSmtpEmail(const QString &to, const QString &subject,
-                               const QString &body, const QStringList &attachments)
+void EmailClient::doFetchEmailBody(const Email &email)
 {
+    if (!m_connected || email.uid == 0) {
+        return;
+    }
+
     try {
-        // 如果SMTP连接不存在，创建新连接
-        if (!m_smtp) {
-            m_smtp = std::make_unique<mailio::smtp>(m_currentAccount.smtpServer.toStdString(),
-                                                   m_currentAccount.smtpPort);
+        Email loaded = email;
+        loaded.content.clear();
+        loaded.attachments.clear();
+        loaded.isHtml = false;
 
-            if (m_currentAccount.smtpEncryption == "ssl") {
-                m_smtp->start_tls(true);
+        // 边接收边解析，整封邮件只保留一份
+        MimeView view;
+        bool structured = false;
+        if (m_currentAccount.protocol == "imap") {
+            if (!m_imap) {
+                emit errorOccurred("IMAP连接未建立");
+                return;
             }
+            selectImapFolder(email.folder);
 
-            m_smtp->authenticate(m_currentAccount.email.toStdString(),
-                                m_currentAccount.password.toStdString(),
-                                mailio::smtp::auth_method_t::LOGIN);
-        }
-
-        mailio::message msg;
-        msg.from(mailio::mail_address(m_currentAccount.email.toStdString(),
-                                     m_currentAccount.email.toStdString()));
-        msg.add_recipient(mailio::mail_address(to.toStdString(), to.toStdString()));
-        msg.subject(subject.toStdString());
-        msg.content(body.toStdString());
-
-        // 添加附件 - 修正附件添加方式
-        std::list<std::tuple<std::istream&, mailio::string_t, mailio::mime::content_type_t>> attachments_list;
-        for (const QString& filePath : attachments) {
-            QFile file(filePath);
-            if (file.open(QIODevice::ReadOnly)) {
-                QByteArray fileData = file.readAll();
-                file.close();
-
-                QFileInfo fileInfo(filePath);
-                std::string filename = fileInfo.fileName().toStdString();
-
-                // 创建字符串流
-                std::string fileContent(fileData.constData(), fileData.size());
-                std::istringstream fileStream(fileContent);
-
-                // 创建正确的 content_type_t 对象
-                mailio::mime::content_type_t contentType(mailio::mime::media_type_t::APPLICATION, "octet-stream");
-
-                // 添加到附件列表
-                attachments_list.push_back(std::make_tuple(
-                    std::ref(fileStream),
-                    mailio::string_t(filename),
-                    contentType
-                ));
+            // 按 BODYSTRUCTURE 只下载要显示的正文部分，附件在保存时才下载
+            const std::vector<ImapSession::BodyPart> parts = m_imap->fetchStructure(email.uid);
+            structured = !parts.empty();
+            if (structured) {
+                if (const ImapSession::BodyPart *text = fillBody(parts, loaded)) {
+                    MimeCodec::StreamDecoder decoder(text->encoding);
+                    std::string decoded;
+                    m_imap->fetchPart(email.uid, text->section, 0, 0,
+                        [&decoder, &decoded](std::string_view chunk, std::size_t total) {
+                            if (decoded.empty()) {
+                                decoded.reserve(total);
+                            }
+                            decoder.decode(chunk, decoded);
+                        });
+                    decoder.finish(decoded);
+                    loaded.content = decodeText(decoded, text->charset);
+                    loaded.isHtml = text->mediaType == "text/html";
+                }
+            } else {
+                // 服务器没有给出可用的结构时下载整封邮件
+                m_imap->fetchRaw(email.uid, [&view](std::string_view chunk, std::size_t total) {
+                    if (view.size() == 0) {
+                        view.reserve(total);
+                    }
+                    view.feed(chunk);
+                });
+            }
+            recordImapTraffic("下载正文");
+        } else {
+            if (!m_pop3 && !connectPop3Server()) {
+                return;
+            }
+            unsigned number = 0;
+            if (!pop3Number(email.uid, number)) {
+                emit errorOccurred("邮件已不在服务器上");
+                return;
             }
+            const std::vector<unsigned long> failed = m_pop3->fetch({number}, false,
+                [&view](unsigned long, std::string_view message) {
+                    view.reserve(message.size());
+                    view.feed(message);
+                });
+            if (!failed.empty()) {
+                emit errorOccurred("邮件已不在服务器上");
+                return;
+            }
+        }
+        if (!structured) {
+            view.finish();
+            fillBody(view, loaded);
         }
+        loaded.bodyLoaded = true;
 
-        // 如果有附件则添加
-        if (!attachments_list.empty()) {
-            msg.attach(attachments_list);
+        // 按结构下载时没有整封邮件，本地存储只保存正文
+        if (m_store && !loaded.folder.isEmpty()) {
+            m_store->storeBody(loaded, QByteArray::fromRawData(view.buffer().data(),
+                                                               static_cast<qsizetype>(view.size())));
         }
 
-        m_smtp->submit(msg);
-        return true;
+        emit emailBodyReceived(loaded);
     } catch (const std::exception& e) {
-        m_lastError = QString::fromStdString(e.what());
+        if (m_currentAccount.protocol != "imap") {
+            dropPop3Session();
+        }
+        m_lastError = QString("获取邮件正文失败: %1").arg(e.what());
         emit errorOccurred(m_lastError);
+    }
+}
+
+void EmailClient::doSaveAttachment(const Email &email, int index, const QString &path)
+{
+    QString error;
+    QSaveFile file(path);
+    try {
+        if (!m_connected || email.uid == 0) {
+            error = "未连接到服务器";
+        } else if (!file.open(QIODevice::WriteOnly)) {
+            error = file.errorString();
+        } else if (m_currentAccount.protocol == "imap") {
+            error = saveImapAttachment(email, index, file);
+        } else {
+            error = savePop3Attachment(email, index, file);
+        }
+    } catch (const std::exception &e) {
+        if (m_currentAccount.protocol != "imap") {
+            dropPop3Session();
+        }
+        error = e.what();
+    }
+    // 未提交的 QSaveFile 不会留下不完整的文件
+    if (error.isEmpty() && !file.commit()) {
+        error = file.errorString();
+    }
+
+    if (!error.isEmpty()) {
+        m_lastError = QString("保存附件失败: %1").arg(error);
+        qWarning() << m_lastError;
+        emit attachmentSaved(email.id, index, path, m_lastError);
+        return;
+    }
+    qDebug() << "附件已保存:" << path;
+    emit attachmentSaved(email.id, index, path, QString());
+}
+
+QString EmailClient::saveImapAttachment(const Email &email, int index, QIODevice &file)
+{
+    if (!m_imap) {
+        return "IMAP连接未建立";
+    }
+    selectImapFolder(email.folder);
+
+    // 邮件结构很小，保存时重新获取，本地存储中不必记录节号
+    const std::vector<ImapSession::BodyPart> parts = m_imap->fetchStructure(email.uid);
+    const ImapSession::BodyPart *attachment = nullptr;
+    int count = 0;
+    for (const ImapSession::BodyPart &part : parts) {
+        if (part.attachment && count++ == index) {
+            attachment = &part;
+            break;
+        }
+    }
+    if (!attachment) {
+        return "附件不存在";
+    }
+
+    // 分段取回，每段解码后立即写入文件，内存中最多保留一段
+    const qint64 total = static_cast<qint64>(attachment->size);
+    MimeCodec::StreamDecoder decoder(attachment->encoding);
+    std::string decoded;
+    std::size_t offset = 0;
+    emit attachmentProgress(email.id, index, 0, total);
+    while (true) {
+        if (m_cancel.load()) {
+            return "已取消";
+        }
+        decoded.clear();
+        const std::size_t received = m_imap->fetchPart(email.uid, attachment->section, offset, kAttachmentChunk,
+            [&decoder, &decoded](std::string_view chunk, std::size_t) {
+                decoder.decode(chunk, decoded);
+            });
+        offset += received;
+        const bool last = received < kAttachmentChunk;
+        if (last) {
+            decoder.finish(decoded);
+        }
+        if (file.write(decoded.data(), static_cast<qint64>(decoded.size())) != static_cast<qint64>(decoded.size())) {
+            return file.errorString();
+        }
+        emit attachmentProgress(email.id, index, static_cast<qint64>(offset),
+                                std::max(total, static_cast<qint64>(offset)));
+        if (last) {
+            break;
+        }
+    }
+    recordImapTraffic("下载附件");
+    return QString();
+}
+
+QString EmailClient::savePop3Attachment(const Email &email, int index, QIODevice &file)
+{
+    if (!m_pop3 && !connectPop3Server()) {
+        return "POP3连接未建立";
+    }
+    unsigned number = 0;
+    if (!pop3Number(email.uid, number)) {
+        return "邮件已不在服务器上";
+    }
+
+    MimeView view;
+    const std::vector<unsigned long> failed = m_pop3->fetch({number}, false,
+        [&view](unsigned long, std::string_view message) {
+            view.reserve(message.size());
+            view.feed(message);
+        });
+    if (!failed.empty()) {
+        return "邮件已不在服务器上";
+    }
+    view.finish();
+
+    int count = 0;
+    for (int i = 0; i < view.partCount(); ++i) {
+        if (!view.isAttachment(i) || count++ != index) {
+            continue;
+        }
+        const std::string decoded = view.decodedBody(i);
+        if (file.write(decoded.data(), static_cast<qint64>(decoded.size())) != static_cast<qint64>(decoded.size())) {
+            return file.errorString();
+        }
+        emit attachmentProgress(email.id, index, static_cast<qint64>(view.body(i).size()),
+                                static_cast<qint64>(view.body(i).size()));
+        return QString();
+    }
+    return "附件不存在";
+}
+
+std::unique_ptr<SmtpSession> EmailClient::openSmtpSession(const EmailAccount &account)
+{
+    auto session = connectSession<SmtpSession>(account.smtpServer, account.smtpPort,
+                                               std::chrono::milliseconds(kSmtpTimeout));
+
+    if (account.smtpEncryption == "ssl") {
+        session->start_tls(true);
+    }
+
+    session->authenticate(account.email.toStdString(),
+                          account.password.toStdString(),
+                          mailio::smtp::auth_method_t::LOGIN);
+    return session;
+}
+
+bool EmailClient::connectSmtpServer()
+{
+    m_smtp.reset();
+    try {
+        m_smtp = openSmtpSession(m_currentAccount);
+        m_smtpLastUsed = std::chrono::steady_clock::now();
+        return true;
+    } catch (const std::exception& e) {
+        // 由发件箱记录错误并重试，离线时不逐次弹出提示
+        m_lastError = QString("SMTP连接失败: %1").arg(e.what());
+        return false;
+    }
+}
+
+bool EmailClient::acquireSmtp()
+{
+    // 复用已认证的连接可以省去 TCP、TLS、EHLO 和 AUTH 的往返
+    if (m_smtp) {
+        if (smtpIdleRemaining() > 0 && m_smtp->probe()) {
+            return true;
+        }
+        qDebug() << "SMTP 连接已失效，重新连接";
+    }
+    return connectSmtpServer();
+}
+
+qint64 EmailClient::smtpIdleRemaining() const
+{
+    const int timeout = m_smtpIdleTimeout.load();
+    if (timeout == 0) {
+        return std::numeric_limits<qint64>::max();
+    }
+    const auto idle = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - m_smtpLastUsed);
+    return std::max<qint64>(0, timeout * 1000LL - idle.count());
+}
+
+bool EmailClient::sendSmtpEmail(const Outbox::Entry &entry, QString &error, bool &permanent,
+                                QStringList &rejected)
+{
+    permanent = false;
+    const QStringList recipients = entry.to.split(QRegularExpression("[,;\\s]+"), Qt::SkipEmptyParts);
+    if (recipients.isEmpty()) {
+        permanent = true;
+        error = "没有收件人";
         return false;
     }
+
+    // 附件在发送前全部打开，文件已不存在时重试也没有意义
+    std::vector<std::unique_ptr<QFile>> files;
+    MimeWriter::Message message;
+    QMimeDatabase mimeDatabase;
+    for (const QString &filePath : entry.attachments) {
+        auto file = std::make_unique<QFile>(filePath);
+        if (!file->open(QIODevice::ReadOnly)) {
+            permanent = true;
+            error = QString("无法读取附件 %1: %2").arg(filePath, file->errorString());
+            return false;
+        }
+        QFile *source = file.get();
+        message.attachments.push_back({
+            QFileInfo(filePath).fileName().toStdString(),
+            mimeDatabase.mimeTypeForFile(filePath).name().toStdString(),
+            [source](char *buffer, std::size_t size) -> std::size_t {
+                const qint64 count = source->read(buffer, static_cast<qint64>(size));
+                if (count < 0) {
+                    throw std::runtime_error(source->errorString().toStdString());
+                }
+                return static_cast<std::size_t>(count);
+            }
+        });
+        files.push_back(std::move(file));
+    }
+
+    SmtpSession::Envelope envelope;
+    envelope.from = m_currentAccount.email.toStdString();
+    message.from = envelope.from;
+    for (const QString &to : recipients) {
+        envelope.recipients.push_back(to.toStdString());
+        message.to.push_back(to.toStdString());
+    }
+    message.subject = entry.subject.toStdString();
+    message.date = QDateTime::currentDateTime().toString(Qt::RFC2822Date).toStdString();
+    message.messageId = QString("<%1@%2>").arg(QUuid::createUuid().toString(QUuid::WithoutBraces),
+                                               m_currentAccount.email.section('@', 1)).toStdString();
+    message.body = entry.body.toStdString();
+    message.html = entry.isHtml;
+
+    if (!acquireSmtp()) {
+        error = m_lastError;
+        return false;
+    }
+
+    try {
+        // 附件边读边编码，直接写入连接，内存占用与附件大小无关
+        MimeWriter writer(std::move(message));
+        const auto rejections = m_smtp->sendMail(envelope, [&writer]() { return writer.next(); });
+        m_smtpLastUsed = std::chrono::steady_clock::now();
+        for (const SmtpSession::Rejection &rejection : rejections) {
+            rejected << QString("%1 (%2 %3)").arg(QString::fromStdString(rejection.recipient))
+                                             .arg(rejection.status)
+                                             .arg(QString::fromStdString(rejection.reply));
+        }
+        return true;
+    } catch (const mailio::smtp_error& e) {
+        // 5xx 是服务器对这封邮件的最终答复，4xx 和其他错误都值得重试
+        permanent = m_smtp && m_smtp->lastReplyStatus() >= 500;
+        error = QString::fromStdString(e.what());
+        if (m_smtp) {
+            error += " " + QString::fromStdString(m_smtp->lastReplyText());
+        }
+    } catch (const std::exception& e) {
+        error = QString::fromStdString(e.what());
+    }
+
+    // 失败后连接停在未知状态，下次发送时重新建立
+    m_smtp.reset();
+    m_lastError = error;
+    return false;
 }
 
 
@@ -6,13 +6,30 @@
 #include <QThread>
 #include <QString>
 #include <QStringList>
+#include <QIODevice>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QSemaphore>
 #include <memory>
+#include <deque>
+#include <atomic>
 #include <chrono>
+#include <algorithm>
+#include <vector>
 #include "accountdialog.h"  // 包含 EmailAccount 定义
+#include "mailstore.h"
+#include "imapsession.h"
+#include "pop3session.h"
+#include "imapidleclient.h"
+#include "smtpsession.h"
+#include "outbox.h"
+#include "bulksender.h"
+#include "mimeview.h"
+#include "pop3seenset.h"
 #include "libs/mailio/include/imap.hpp"
 #include "libs/mailio/include/pop3.hpp"
 #include "libs/mailio/include/smtp.hpp"
-#include "libs/mailio/include/message.hpp"
 
 class EmailClient : public QObject
 {
@@ -22,46 +39,223 @@ public:
     explicit EmailClient(QObject *parent = nullptr);
     ~EmailClient();
 
+    // 以下操作只是加入命令队列，由工作线程依次执行，可以在任意线程调用。
+    // 协议对象只在工作线程中使用
     void connectToServer(const EmailAccount &account);
     void disconnectFromServer();
+    // 队列中已有同步命令时合并为一次
     void fetchEmails();
-    void sendEmail(const QString &to, const QString &subject,
-                   const QString &body, const QStringList &attachments = QStringList());
+    // 按需下载邮件正文和附件列表。IMAP 先取邮件结构，只下载显示用的正文部分，附件不下载
+    void fetchEmailBody(const Email &email);
+    // 把第 index 个附件（与 Email::attachments 的顺序相同）保存到 path。
+    // IMAP 分段下载该附件并报告进度，POP3 不支持按部分下载，要重新下载整封邮件
+    void saveAttachment(const Email &email, int index, const QString &path);
+    // 发送发件箱中到期的邮件，失败的邮件由工作线程按退避时间自动重试
+    void flushOutbox();
+    // 预先建立（或探测已有的）SMTP 连接，在撰写邮件时调用，点击发送时不必再等待
+    // TCP、TLS 和认证的往返。setSmtpWarmUp(false) 时不做任何事
+    void prepareSmtp();
+    void setSmtpWarmUp(bool enabled) { m_smtpWarmUp = enabled; }
+    // 丢弃排队中的同步和下载命令，并让正在进行的同步或附件下载尽快结束
+    void cancelPending();
+
+    // 群发通知：每个收件人单独收到一封，正文和附件只编码一次。
+    // 在独立的连接池上发送，不占用工作线程；上一次群发未结束时返回 false
+    bool sendBulk(const EmailAccount &account, const QString &subject, const QString &body, bool html,
+                  const QStringList &attachments, const QStringList &recipients);
+    void cancelBulk();
+    // 群发使用的连接数和每分钟发送上限（0 表示不限速），对下一次群发生效
+    void setBulkLimits(int connections, int messagesPerMinute);
 
     // 添加公共方法
-    bool isConnected() const { return m_connected; }
+    bool isConnected() const { return m_connected.load(); }
+    // 是否有处于 IDLE 状态的推送连接
+    bool isIdleActive() const { return m_idleActive.load(); }
+    // IMAP 同步和下载正文累计收发的字节数：wire 为连接上实际传输的，data 为压缩前的 IMAP 数据，
+    // 两者之比就是 COMPRESS=DEFLATE 节省的流量
+    quint64 imapWireBytes() const { return m_imapWireBytes.load(); }
+    quint64 imapDataBytes() const { return m_imapDataBytes.load(); }
+
+    // 同步结果写入本地存储，UID 同步状态也从存储恢复
+    void setMailStore(MailStore *store) { m_store = store; }
+    // 待发送的邮件保存在发件箱中，需在启动工作线程处理发送前设置
+    void setOutbox(Outbox *outbox) { m_outbox = outbox; }
+
+    // 多个账户共享的网络并发额度，每条命令执行期间占用一个，需在提交命令前设置
+    void setNetworkBudget(QSemaphore *budget) { m_networkBudget = budget; }
+
+    // 每条 FETCH 命令批量下载的邮件数量
+    void setFetchBatchSize(int size) { m_fetchBatchSize = std::max(1, size); }
+    int fetchBatchSize() const { return m_fetchBatchSize; }
+
+    // SMTP 连接在两次发送之间保持打开，空闲超过该时间（秒）后关闭，0 表示不主动关闭
+    void setSmtpIdleTimeout(int seconds) { m_smtpIdleTimeout = std::max(0, seconds); }
+    int smtpIdleTimeout() const { return m_smtpIdleTimeout.load(); }
+
+    // POP3 邮件下载后在服务器上保留的天数，超过后删除；0 表示一直保留
+    void setPop3RetentionDays(int days) { m_pop3RetentionDays = std::max(0, days); }
+    int pop3RetentionDays() const { return m_pop3RetentionDays.load(); }
 
 signals:
     void connectionStatusChanged(bool connected);
-    void newEmailReceived(const QString &from, const QString &subject,
-                         const QString &body, bool isHtml,
-                         const QStringList &attachments);
-    void emailSent(bool success);
+    void newEmailReceived(const Email &email);
+    void emailBodyReceived(const Email &email);
+    // 附件下载进度，total 为传输编码后的大小
+    void attachmentProgress(const QString &emailId, int index, qint64 received, qint64 total);
+    // 附件保存结束，error 为空表示成功
+    void attachmentSaved(const QString &emailId, int index, const QString &path, const QString &error);
+    // UIDVALIDITY 变化，本地缓存的该文件夹邮件全部失效
+    void mailboxReset(const QString &folder);
+    // IDLE 推送：服务器通知文件夹有变化，需要同步
+    void mailboxChanged(const QString &folder);
+    void idleStateChanged(bool active);
+    // 群发进度，从发送线程发出
+    void bulkProgress(int sent, int failed, int total);
+    void bulkRecipientFailed(const QString &address, const QString &error);
+    void bulkFinished(int sent, int failed, bool cancelled);
+    // 发件箱中邮件的状态变化，state 为 Outbox::State，Outbox::Sent 表示已送达
+    void outboxStateChanged(const QString &emailId, int state, const QString &error);
     void errorOccurred(const QString &error);
 
 private slots:
     void onTimeout();
 
 private:
+    struct Command {
+        enum Type { Connect, Disconnect, Sync, FetchBody, SaveAttachment, FlushOutbox, WarmUpSmtp } type;
+        EmailAccount account;
+        Email email;
+        // SaveAttachment 的附件序号和保存路径
+        int attachment = -1;
+        QString path;
+    };
+
+    void enqueue(Command command);
+    void workerLoop();
+    void execute(const Command &command);
+    // 退出时返回 false
+    bool acquireBudget();
+    void releaseBudget();
+    void doConnect(const EmailAccount &account);
+    void doDisconnect();
+    void doFetchEmails();
+    void doFetchEmailBody(const Email &email);
+    void doSaveAttachment(const Email &email, int index, const QString &path);
+    // 把附件解码后写入 file，失败时返回原因
+    QString saveImapAttachment(const Email &email, int index, QIODevice &file);
+    QString savePop3Attachment(const Email &email, int index, QIODevice &file);
+    // 本地 UID 换成本次 POP3 会话中的邮件序号，邮件已不在服务器上时返回 false
+    bool pop3Number(unsigned long uid, unsigned &number);
+    void drainOutbox();
+    // 工作线程下一个定时任务（SMTP 空闲关闭、发件箱重试）的毫秒数，-1 表示没有
+    qint64 nextTimerMsecs() const;
+    qint64 outboxDueMsecs() const;
+    void runTimers();
+
     bool connectImapServer();
     bool connectPop3Server();
+    // 读取中途出错后连接上可能还有未读的响应，丢弃连接，下一条命令重新连接
+    void dropPop3Session();
+    // 记下新建的连接，析构已经开始时直接关闭它
+    void trackConnection(const std::weak_ptr<mailio::dialog> &connection);
     bool fetchImapEmails();
+    // 下载正文或附件前选中邮件所在的文件夹
+    void selectImapFolder(const QString &folder);
     bool fetchPop3Emails();
+    // 已下载记录保存在账户存储目录中，没有本地存储时只保存在内存里
+    QString pop3SeenPath() const;
     bool connectSmtpServer();
-    bool sendSmtpEmail(const QString &to, const QString &subject,
-                      const QString &body, const QStringList &attachments);
+    // 建立并认证一个 SMTP 连接，失败时抛出异常
+    static std::unique_ptr<SmtpSession> openSmtpSession(const EmailAccount &account);
+    // 返回可用的 SMTP 连接：探测已有连接，失效时重新连接
+    bool acquireSmtp();
+    // 工作线程空闲等待的时长，SMTP 连接到期时返回 0
+    qint64 smtpIdleRemaining() const;
+    void startIdle();
+    void stopIdle();
+    // 把 IMAP 会话的流量计入累计值
+    void recordImapTraffic(const char *operation);
+    // 失败时 error 为原因，permanent 表示服务器永久拒绝（5xx），重试也不会成功。
+    // 成功时 rejected 为被服务器拒绝的收件人（附应答），邮件已发给其余收件人
+    bool sendSmtpEmail(const Outbox::Entry &entry, QString &error, bool &permanent, QStringList &rejected);
+    Email buildEmail(const MimeView &header, const QString &id) const;
+    void fillBody(const MimeView &view, Email &email) const;
+    // 按邮件结构填写附件列表，返回应显示的正文部分，没有文本正文时返回 nullptr
+    const ImapSession::BodyPart *fillBody(const std::vector<ImapSession::BodyPart> &parts, Email &email) const;
+    static std::string toUidSet(const std::vector<unsigned long> &uids);
+
+    // 文件夹的 UID 同步状态，只下载 UID 大于 lastUid 的邮件
+    struct FolderSyncState {
+        unsigned long uidValidity = 0;
+        unsigned long uidNext = 0;
+        unsigned long lastUid = 0;
+    };
 
     EmailAccount m_currentAccount;
-    bool m_connected;
+    std::atomic<bool> m_connected;
     QTimer *m_timeoutTimer;
     QThread *m_workerThread;
 
+    // 工作线程的命令队列
+    QMutex m_queueMutex;
+    QWaitCondition m_queueCondition;
+    std::deque<Command> m_queue;
+    bool m_quit;
+    std::atomic<bool> m_cancel{false};
+
     // 添加智能指针成员变量
-    std::unique_ptr<mailio::imap> m_imap;
-    std::unique_ptr<mailio::pop3> m_pop3;
-    std::unique_ptr<mailio::smtp> m_smtp;
+    std::unique_ptr<ImapSession> m_imap;
+    std::unique_ptr<Pop3Session> m_pop3;
+    std::unique_ptr<SmtpSession> m_smtp;
+    // IMAP、POP3 会话的读取没有超时，服务器不响应时工作线程会一直阻塞。
+    // 析构时在 GUI 线程关闭当前连接，让读取立即失败，工作线程才能退出
+    QMutex m_connectionMutex;
+    std::weak_ptr<mailio::dialog> m_connection;
+    bool m_connectionAborted = false;
+    std::chrono::steady_clock::time_point m_smtpLastUsed;
+    std::atomic<int> m_smtpIdleTimeout{300};
+    std::atomic<bool> m_smtpWarmUp{true};
 
     QString m_lastError;  // 添加错误信息成员变量
+
+    QHash<QString, FolderSyncState> m_folderStates;
+
+    // POP3 同步状态：已下载的 UIDL 和本次会话中本地 UID 对应的服务器邮件序号
+    Pop3SeenSet m_pop3Seen;
+    bool m_pop3SeenLoaded = false;
+    QHash<quint32, unsigned> m_pop3Numbers;
+    // 本次 POP3 会话发送过 DELE，下次同步前要 QUIT 提交删除并重新连接
+    bool m_pop3Removed = false;
+    std::atomic<int> m_pop3RetentionDays{0};
+    QString m_selectedFolder;
+    // 选中的文件夹已同步到 SELECT 时的状态，此后的新邮件由 NOOP 的 EXISTS 报告
+    bool m_selectionSynced = false;
+    int m_fetchBatchSize;
+    MailStore *m_store;
+    Outbox *m_outbox;
+    QSemaphore *m_networkBudget;
+    QDateTime m_outboxHold;  // 暂时性失败后整个发件箱推迟到这个时间
+
+    // 群发任务，运行在自己的线程上
+    QMutex m_bulkMutex;
+    std::unique_ptr<BulkSender> m_bulk;
+    BulkSender::Options m_bulkOptions;
+
+    // IDLE 推送连接，异步运行在 AsyncRuntime 的线程上，只在工作线程中启动和停止
+    std::shared_ptr<ImapIdleClient> m_idleClient;
+    std::atomic<bool> m_idleActive{false};
+
+    std::atomic<quint64> m_imapWireBytes{0};
+    std::atomic<quint64> m_imapDataBytes{0};
+
+    // POP3 邮件在本地存储中使用的 UIDVALIDITY，本地 UID 由 Pop3SeenSet 分配
+    static constexpr unsigned long kPop3UidValidity = 1;
+    // POP3 每次批量下载的邮件数量，批内按 Pop3Session 的窗口流水线发送
+    static constexpr size_t kPop3FetchBatch = 256;
+    // IMAP 分段下载附件时每段的字节数（传输编码后），每段之后报告一次进度
+    static constexpr std::size_t kAttachmentChunk = 1024 * 1024;
+    // SMTP 单次读写的超时，避免探测时卡在已被 NAT 丢弃的连接上
+    static constexpr std::chrono::seconds kSmtpTimeout{30};
 };
 
 #endif // EMAILCLIENT_H
@@ -0,0 +1,258 @@
+#include "hostresolver.h"
+#include <algorithm>
+
+namespace {
+
+// 地址探测的超时，超时后仍交给 mailio 按主机名连接
+const std::chrono::seconds kProbeTimeout{10};
+
+} // namespace
+
+HostResolver &HostResolver::instance()
+{
+    static HostResolver resolver;
+    return resolver;
+}
+
+HostResolver::Endpoints HostResolver::order(const Entry &entry, unsigned short port)
+{
+    Endpoints endpoints;
+    endpoints.reserve(entry.addresses.size());
+    if (entry.hasPreferred) {
+        endpoints.emplace_back(entry.preferred, port);
+    }
+
+    std::vector<boost::asio::ip::address> v6, v4;
+    for (const auto &address : entry.addresses) {
+        if (entry.hasPreferred && address == entry.preferred) {
+            continue;
+        }
+        (address.is_v6() ? v6 : v4).push_back(address);
+    }
+
+    // 首选地址之后换另一族开始交替，没有首选时 IPv6 在先
+    bool six = !(entry.hasPreferred && entry.preferred.is_v6());
+    std::size_t i6 = 0, i4 = 0;
+    while (i6 < v6.size() || i4 < v4.size()) {
+        if ((six && i6 < v6.size()) || i4 == v4.size()) {
+            endpoints.emplace_back(v6[i6++], port);
+        } else {
+            endpoints.emplace_back(v4[i4++], port);
+        }
+        six = !six;
+    }
+    return endpoints;
+}
+
+bool HostResolver::lookup(const std::string &host, unsigned short port, Endpoints &endpoints)
+{
+    boost::system::error_code error;
+    const boost::asio::ip::address literal = boost::asio::ip::make_address(host, error);
+    if (!error) {
+        endpoints.assign(1, boost::asio::ip::tcp::endpoint(literal, port));
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(host);
+    if (it == m_entries.end() || it->second.expires <= std::chrono::steady_clock::now()) {
+        return false;
+    }
+    endpoints = order(it->second, port);
+    return true;
+}
+
+HostResolver::Endpoints HostResolver::store(const std::string &host, unsigned short port,
+                                            const boost::asio::ip::tcp::resolver::results_type &results)
+{
+    std::vector<boost::asio::ip::address> addresses;
+    for (const auto &result : results) {
+        const boost::asio::ip::address address = result.endpoint().address();
+        if (std::find(addresses.begin(), addresses.end(), address) == addresses.end()) {
+            addresses.push_back(address);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry &entry = m_entries[host];
+    entry.addresses = std::move(addresses);
+    entry.expires = std::chrono::steady_clock::now() + kTtl;
+    // 重新解析后首选地址仍然有效时保留
+    if (entry.hasPreferred
+        && std::find(entry.addresses.begin(), entry.addresses.end(), entry.preferred) == entry.addresses.end()) {
+        entry.hasPreferred = false;
+    }
+    return order(entry, port);
+}
+
+HostResolver::Endpoints HostResolver::resolve(const std::string &host, unsigned short port)
+{
+    Endpoints endpoints;
+    if (lookup(host, port, endpoints)) {
+        return endpoints;
+    }
+    boost::asio::io_context context;
+    boost::asio::ip::tcp::resolver resolver(context);
+    return store(host, port, resolver.resolve(host, std::to_string(port)));
+}
+
+std::string HostResolver::address(const std::string &host, unsigned short port)
+{
+    try {
+        const Endpoints endpoints = resolve(host, port);
+        bool known = endpoints.size() == 1;
+        if (!known) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_entries.find(host);
+            known = it != m_entries.end() && it->second.hasPreferred;
+        }
+        if (known) {
+            return endpoints.front().address().to_string();
+        }
+
+        // 还不知道哪个地址可用：并行试连一次，记住最先连上的
+        boost::asio::ip::tcp::endpoint winner;
+        if (ConnectRace::connect(endpoints, kProbeTimeout, winner)) {
+            connected(host, winner.address());
+            return winner.address().to_string();
+        }
+    } catch (const std::exception &) {
+    }
+    return host;
+}
+
+void HostResolver::connected(const std::string &host, const boost::asio::ip::address &address)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(host);
+    if (it != m_entries.end()) {
+        it->second.preferred = address;
+        it->second.hasPreferred = true;
+    }
+}
+
+void HostResolver::invalidate(const std::string &host)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.erase(host);
+}
+
+std::shared_ptr<ConnectRace> ConnectRace::start(const boost::asio::any_io_executor &executor,
+                                                HostResolver::Endpoints endpoints, Handler handler)
+{
+    std::shared_ptr<ConnectRace> race(new ConnectRace(executor, std::move(endpoints), std::move(handler)));
+    if (race->m_endpoints.empty()) {
+        boost::asio::post(executor, [race]() {
+            race->finish(boost::asio::error::host_not_found, nullptr, boost::asio::ip::tcp::endpoint());
+        });
+    } else {
+        boost::asio::dispatch(executor, [race]() { race->attempt(); });
+    }
+    return race;
+}
+
+bool ConnectRace::connect(const HostResolver::Endpoints &endpoints, std::chrono::milliseconds timeout,
+                          boost::asio::ip::tcp::endpoint &winner)
+{
+    boost::asio::io_context context;
+    boost::asio::steady_timer deadline(context, timeout);
+    bool connected = false;
+    std::shared_ptr<ConnectRace> race = start(context.get_executor(), endpoints,
+        [&](const boost::system::error_code &error, boost::asio::ip::tcp::socket, const boost::asio::ip::tcp::endpoint &endpoint) {
+            // 只用来探测，连接随 socket 一起关闭
+            connected = !error;
+            winner = endpoint;
+            deadline.cancel();
+        });
+
+    deadline.async_wait([&race](const boost::system::error_code &error) {
+        if (!error) {
+            race->cancel();
+        }
+    });
+    context.run();
+    return connected;
+}
+
+ConnectRace::ConnectRace(const boost::asio::any_io_executor &executor, HostResolver::Endpoints endpoints, Handler handler)
+    : m_executor(executor)
+    , m_endpoints(std::move(endpoints))
+    , m_handler(std::move(handler))
+    , m_delay(executor)
+{
+}
+
+void ConnectRace::attempt()
+{
+    if (m_finished || m_next >= m_endpoints.size()) {
+        return;
+    }
+
+    const boost::asio::ip::tcp::endpoint endpoint = m_endpoints[m_next++];
+    m_sockets.push_back(std::make_unique<boost::asio::ip::tcp::socket>(m_executor));
+    boost::asio::ip::tcp::socket *socket = m_sockets.back().get();
+    ++m_pending;
+    socket->async_connect(endpoint, [self = shared_from_this(), socket, endpoint](const boost::system::error_code &error) {
+        --self->m_pending;
+        if (self->m_finished) {
+            return;
+        }
+        if (!error) {
+            self->finish(error, socket, endpoint);
+            return;
+        }
+        self->m_lastError = error;
+        if (self->m_next < self->m_endpoints.size()) {
+            self->attempt();
+        } else if (self->m_pending == 0) {
+            self->finish(error, nullptr, endpoint);
+        }
+    });
+
+    // 这个地址迟迟没有结果时并行尝试下一个
+    if (m_next < m_endpoints.size()) {
+        m_delay.expires_after(kAttemptDelay);
+        m_delay.async_wait([self = shared_from_this()](const boost::system::error_code &error) {
+            if (!error) {
+                self->attempt();
+            }
+        });
+    }
+}
+
+void ConnectRace::finish(const boost::system::error_code &error, boost::asio::ip::tcp::socket *socket,
+                         const boost::asio::ip::tcp::endpoint &endpoint)
+{
+    m_finished = true;
+    m_delay.cancel();
+
+    boost::asio::ip::tcp::socket result(m_executor);
+    if (socket) {
+        result = std::move(*socket);
+    }
+    boost::system::error_code ignored;
+    for (const auto &other : m_sockets) {
+        if (other.get() != socket) {
+            other->close(ignored);
+        }
+    }
+
+    Handler handler = std::move(m_handler);
+    handler(error, std::move(result), endpoint);
+}
+
+void ConnectRace::cancel()
+{
+    if (m_finished) {
+        return;
+    }
+    m_next = m_endpoints.size();
+    m_delay.cancel();
+    boost::system::error_code ignored;
+    for (const auto &socket : m_sockets) {
+        socket->close(ignored);
+    }
+    if (m_pending == 0) {
+        finish(boost::asio::error::operation_aborted, nullptr, boost::asio::ip::tcp::endpoint());
+    }
+}
@@ -0,0 +1,112 @@
+#ifndef HOSTRESOLVER_H
+#define HOSTRESOLVER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <boost/asio.hpp>
+
+/*
+ * 主机名解析缓存
+ *
+ * 同一账户的 IMAP、SMTP 连接和重新连接每次都要重新解析同一个主机名。
+ * 这里按主机名缓存解析结果 kTtl 时间（Asio 不提供 DNS 记录的 TTL），
+ * 地址按 RFC 8305 排列：上次连接成功的地址在最前，其余 IPv6 与 IPv4 交替。
+ *
+ * mailio 的连接只接受一个主机名，address() 给它一个已知可用的地址字面量，
+ * 省去解析；还没有可用地址时先用 ConnectRace 并行试连一次。
+ * 所有方法都是线程安全的。
+ */
+class HostResolver
+{
+public:
+    using Endpoints = std::vector<boost::asio::ip::tcp::endpoint>;
+
+    static constexpr std::chrono::minutes kTtl{5};
+
+    static HostResolver &instance();
+
+    // 缓存中有未过期的结果时写入 endpoints 并返回 true，不阻塞。IP 字面量总是命中
+    bool lookup(const std::string &host, unsigned short port, Endpoints &endpoints);
+    // 保存异步解析的结果，返回排好序的地址
+    Endpoints store(const std::string &host, unsigned short port,
+                    const boost::asio::ip::tcp::resolver::results_type &results);
+    // 阻塞解析，优先使用缓存，失败时抛出 boost::system::system_error
+    Endpoints resolve(const std::string &host, unsigned short port);
+
+    // 给 mailio 使用的地址字面量，解析失败时返回 host 本身，由 mailio 报告错误
+    std::string address(const std::string &host, unsigned short port);
+
+    // 连接成功的地址，之后排在最前
+    void connected(const std::string &host, const boost::asio::ip::address &address);
+    // 连接失败，丢弃缓存，下次重新解析
+    void invalidate(const std::string &host);
+
+    HostResolver(const HostResolver&) = delete;
+    HostResolver& operator=(const HostResolver&) = delete;
+
+private:
+    struct Entry {
+        std::vector<boost::asio::ip::address> addresses;
+        std::chrono::steady_clock::time_point expires;
+        boost::asio::ip::address preferred;
+        bool hasPreferred = false;
+    };
+
+    HostResolver() = default;
+
+    static Endpoints order(const Entry &entry, unsigned short port);
+
+    std::mutex m_mutex;
+    std::map<std::string, Entry> m_entries;
+};
+
+/*
+ * RFC 8305（Happy Eyeballs）式的并行连接
+ *
+ * 按顺序尝试各个地址：一个地址 kAttemptDelay 内没有结果就同时开始下一个，
+ * 失败时立即开始下一个；第一个连上的获胜，其余的被关闭。
+ * IPv6 线路不通时不必等到连接超时才退回 IPv4。
+ * 回调在 executor 上调用且只调用一次；cancel() 也必须在 executor 上调用。
+ */
+class ConnectRace : public std::enable_shared_from_this<ConnectRace>
+{
+public:
+    using Handler = std::function<void(const boost::system::error_code &error,
+                                       boost::asio::ip::tcp::socket socket,
+                                       const boost::asio::ip::tcp::endpoint &endpoint)>;
+
+    static constexpr std::chrono::milliseconds kAttemptDelay{250};
+
+    static std::shared_ptr<ConnectRace> start(const boost::asio::any_io_executor &executor,
+                                              HostResolver::Endpoints endpoints, Handler handler);
+    // 阻塞版本，在内部的 io_context 上运行，超时或全部失败时返回 false
+    static bool connect(const HostResolver::Endpoints &endpoints, std::chrono::milliseconds timeout,
+                        boost::asio::ip::tcp::endpoint &winner);
+
+    // 关闭所有尝试，回调以错误结束
+    void cancel();
+
+private:
+    ConnectRace(const boost::asio::any_io_executor &executor, HostResolver::Endpoints endpoints, Handler handler);
+
+    void attempt();
+    void finish(const boost::system::error_code &error, boost::asio::ip::tcp::socket *socket,
+                const boost::asio::ip::tcp::endpoint &endpoint);
+
+    boost::asio::any_io_executor m_executor;
+    HostResolver::Endpoints m_endpoints;
+    Handler m_handler;
+    std::vector<std::unique_ptr<boost::asio::ip::tcp::socket>> m_sockets;
+    boost::asio::steady_timer m_delay;
+    boost::system::error_code m_lastError;
+    std::size_t m_next = 0;
+    int m_pending = 0;
+    bool m_finished = false;
+};
+
+#endif // HOSTRESOLVER_H
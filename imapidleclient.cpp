@@ -0,0 +1,391 @@
+#include "imapidleclient.h"
+#include <future>
+#include <sstream>
+#include <boost/algorithm/string.hpp>
+
+namespace {
+
+bool startsWith(const std::string &line, const std::string &prefix)
+{
+    return line.compare(0, prefix.size(), prefix) == 0;
+}
+
+} // namespace
+
+constexpr std::chrono::seconds ImapIdleClient::kTimeout;
+constexpr std::chrono::minutes ImapIdleClient::kIdleRefresh;
+constexpr std::chrono::seconds ImapIdleClient::kMaxBackoff;
+
+std::shared_ptr<ImapIdleClient> ImapIdleClient::create(const Settings &settings, ChangeHandler changed,
+                                                       StateHandler stateChanged, AsyncRuntime &runtime)
+{
+    return std::shared_ptr<ImapIdleClient>(
+        new ImapIdleClient(settings, std::move(changed), std::move(stateChanged), runtime));
+}
+
+ImapIdleClient::ImapIdleClient(const Settings &settings, ChangeHandler changed, StateHandler stateChanged,
+                               AsyncRuntime &runtime)
+    : m_settings(settings)
+    , m_changed(std::move(changed))
+    , m_stateChanged(std::move(stateChanged))
+    , m_runtime(runtime)
+    , m_strand(boost::asio::make_strand(runtime.context()))
+    , m_timer(m_strand)
+{
+}
+
+void ImapIdleClient::start()
+{
+    boost::asio::post(m_strand, [self = shared_from_this()]() {
+        if (!self->m_stopped) {
+            self->connect();
+        }
+    });
+}
+
+void ImapIdleClient::stop()
+{
+    std::promise<void> stopped;
+    boost::asio::post(m_strand, [self = shared_from_this(), &stopped]() {
+        self->m_stopped = true;
+        ++self->m_generation;
+        self->m_timer.cancel();
+        if (self->m_dialog) {
+            self->m_dialog->close();
+            self->m_dialog.reset();
+        }
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+}
+
+void ImapIdleClient::connect()
+{
+    const unsigned generation = ++m_generation;
+    m_refreshing = false;
+    m_dialog = AsyncDialog::create(m_strand, m_runtime);
+    m_dialog->setTimeout(kTimeout);
+
+    auto self = shared_from_this();
+    m_dialog->connect(m_settings.host, m_settings.port, [self, generation](const boost::system::error_code &error) {
+        if (!self->isCurrent(generation)) {
+            return;
+        }
+        if (error) {
+            self->fail(error.message());
+            return;
+        }
+        if (self->m_settings.security != Settings::Tls) {
+            self->readGreeting();
+            return;
+        }
+        self->m_dialog->startTls(self->m_settings.host, [self, generation](const boost::system::error_code &error) {
+            if (!self->isCurrent(generation)) {
+                return;
+            }
+            if (error) {
+                self->fail(error.message());
+                return;
+            }
+            self->readGreeting();
+        });
+    });
+}
+
+void ImapIdleClient::readGreeting()
+{
+    const unsigned generation = m_generation;
+    auto self = shared_from_this();
+    m_dialog->readLine([self, generation](const boost::system::error_code &error, std::string line) {
+        if (!self->isCurrent(generation)) {
+            return;
+        }
+        if (error) {
+            self->fail(error.message());
+            return;
+        }
+        if (!boost::istarts_with(line, "* OK")) {
+            self->fail("Connection rejection: " + line);
+            return;
+        }
+        if (self->m_settings.security != Settings::StartTls) {
+            self->login();
+            return;
+        }
+
+        self->command("STARTTLS", [self, generation](bool ok, const std::string &line) {
+            if (!ok) {
+                self->fail("STARTTLS failure: " + line);
+                return;
+            }
+            self->m_dialog->startTls(self->m_settings.host, [self, generation](const boost::system::error_code &error) {
+                if (!self->isCurrent(generation)) {
+                    return;
+                }
+                if (error) {
+                    self->fail(error.message());
+                    return;
+                }
+                self->login();
+            });
+        });
+    });
+}
+
+void ImapIdleClient::login()
+{
+    auto self = shared_from_this();
+    command("LOGIN " + quoted(m_settings.user) + " " + quoted(m_settings.password),
+            [self](bool ok, const std::string &line) {
+        if (!ok) {
+            self->fail("Authentication failure: " + line);
+            return;
+        }
+        self->command("SELECT " + quoted(self->m_settings.folder), [self](bool ok, const std::string &line) {
+            if (!ok) {
+                self->fail("Selecting mailbox failure: " + line);
+                return;
+            }
+            self->enterIdle();
+        });
+    });
+}
+
+void ImapIdleClient::command(const std::string &command, Done done)
+{
+    const unsigned generation = m_generation;
+    const std::string tag = "A" + std::to_string(++m_nextTag);
+    auto self = shared_from_this();
+    m_dialog->sendLine(tag + " " + command, [self, generation](const boost::system::error_code &error) {
+        if (error && self->isCurrent(generation)) {
+            self->fail(error.message());
+        }
+    });
+    readTagged(tag, std::move(done));
+}
+
+void ImapIdleClient::readTagged(const std::string &tag, Done done)
+{
+    const unsigned generation = m_generation;
+    auto self = shared_from_this();
+    m_dialog->readLine([self, generation, tag, done = std::move(done)](const boost::system::error_code &error,
+                                                                       std::string line) {
+        if (!self->isCurrent(generation)) {
+            return;
+        }
+        if (error) {
+            self->fail(error.message());
+            return;
+        }
+
+        if (startsWith(line, tag + " ")) {
+            done(boost::istarts_with(line.substr(tag.size() + 1), "OK"), line);
+            return;
+        }
+
+        self->handleUntagged(line);
+        const std::size_t literal = literalSize(line);
+        if (literal == 0) {
+            self->readTagged(tag, done);
+            return;
+        }
+        // 跳过未带标签响应中的字面量，其后的内容仍属于同一行
+        self->m_dialog->readLiteral(literal, [self, generation, tag, done](const boost::system::error_code &error,
+                                                                           std::string) {
+            if (!self->isCurrent(generation)) {
+                return;
+            }
+            if (error) {
+                self->fail(error.message());
+                return;
+            }
+            self->readTagged(tag, done);
+        });
+    });
+}
+
+void ImapIdleClient::enterIdle()
+{
+    const unsigned generation = m_generation;
+    m_idleTag = "A" + std::to_string(++m_nextTag);
+    m_refreshing = false;
+
+    auto self = shared_from_this();
+    m_dialog->sendLine(m_idleTag + " IDLE", [self, generation](const boost::system::error_code &error) {
+        if (error && self->isCurrent(generation)) {
+            self->fail(error.message());
+        }
+    });
+    readContinuation();
+}
+
+void ImapIdleClient::readContinuation()
+{
+    const unsigned generation = m_generation;
+    auto self = shared_from_this();
+    m_dialog->readLine([self, generation](const boost::system::error_code &error, std::string line) {
+        if (!self->isCurrent(generation)) {
+            return;
+        }
+        if (error) {
+            self->fail(error.message());
+            return;
+        }
+        if (startsWith(line, "* ")) {
+            self->handleUntagged(line);
+            self->readContinuation();
+            return;
+        }
+        if (!startsWith(line, "+")) {
+            self->fail("IDLE failure: " + line);
+            return;
+        }
+
+        // 等待通知期间不限读超时，连接是否存活由定时刷新检查
+        self->m_dialog->setTimeout(std::chrono::milliseconds(0));
+        self->m_backoff = std::chrono::seconds(1);
+        if (!self->m_active) {
+            self->setActive(true);
+            // 重连期间可能错过通知，补一次同步
+            if (self->m_reconnecting && self->m_changed) {
+                self->m_changed(self->m_settings.folder);
+            }
+            self->m_reconnecting = true;
+        }
+
+        self->m_timer.expires_after(kIdleRefresh);
+        self->m_timer.async_wait([self, generation](const boost::system::error_code &error) {
+            if (!error && self->isCurrent(generation)) {
+                self->refreshIdle();
+            }
+        });
+        self->readIdle();
+    });
+}
+
+void ImapIdleClient::readIdle()
+{
+    const unsigned generation = m_generation;
+    auto self = shared_from_this();
+    m_dialog->readLine([self, generation](const boost::system::error_code &error, std::string line) {
+        if (!self->isCurrent(generation)) {
+            return;
+        }
+        if (error) {
+            self->fail(error.message());
+            return;
+        }
+
+        if (startsWith(line, self->m_idleTag + " ")) {
+            if (!self->m_refreshing || !boost::istarts_with(line.substr(self->m_idleTag.size() + 1), "OK")) {
+                self->fail("IDLE terminated: " + line);
+                return;
+            }
+            self->m_timer.cancel();
+            self->enterIdle();
+            return;
+        }
+
+        if (boost::istarts_with(line, "* BYE")) {
+            self->fail("Server closed the connection: " + line);
+            return;
+        }
+        self->handleUntagged(line);
+        self->readIdle();
+    });
+}
+
+void ImapIdleClient::refreshIdle()
+{
+    const unsigned generation = m_generation;
+    m_refreshing = true;
+    m_dialog->sendLine("DONE");
+
+    // 连接已失效时等不到应答，超时后重连
+    auto self = shared_from_this();
+    m_timer.expires_after(kTimeout);
+    m_timer.async_wait([self, generation](const boost::system::error_code &error) {
+        if (!error && self->isCurrent(generation)) {
+            self->fail("IDLE refresh timeout");
+        }
+    });
+}
+
+void ImapIdleClient::handleUntagged(const std::string &line)
+{
+    // * 23 EXISTS / * 5 EXPUNGE
+    std::istringstream tokens(line);
+    std::string star, keyword;
+    unsigned long number = 0;
+    if (!(tokens >> star >> number >> keyword) || star != "*") {
+        return;
+    }
+    if (m_active && m_changed && (boost::iequals(keyword, "EXISTS") || boost::iequals(keyword, "EXPUNGE"))) {
+        m_changed(m_settings.folder);
+    }
+}
+
+void ImapIdleClient::fail(const std::string &reason)
+{
+    ++m_generation;
+    m_timer.cancel();
+    if (m_dialog) {
+        m_dialog->close();
+        m_dialog.reset();
+    }
+    setActive(false, reason);
+
+    const unsigned generation = m_generation;
+    auto self = shared_from_this();
+    m_timer.expires_after(m_backoff);
+    m_timer.async_wait([self, generation](const boost::system::error_code &error) {
+        if (!error && self->isCurrent(generation)) {
+            self->connect();
+        }
+    });
+    m_backoff = std::min(m_backoff * 2, kMaxBackoff);
+}
+
+void ImapIdleClient::setActive(bool active, const std::string &reason)
+{
+    if (m_active == active) {
+        return;
+    }
+    m_active = active;
+    if (m_stateChanged) {
+        m_stateChanged(active, reason);
+    }
+}
+
+std::string ImapIdleClient::quoted(const std::string &text)
+{
+    std::string result = "\"";
+    for (char ch : text) {
+        if (ch == '"' || ch == '\\') {
+            result.push_back('\\');
+        }
+        result.push_back(ch);
+    }
+    result.push_back('"');
+    return result;
+}
+
+std::size_t ImapIdleClient::literalSize(const std::string &line)
+{
+    // ... {123}
+    if (line.empty() || line.back() != '}') {
+        return 0;
+    }
+    const std::string::size_type open = line.rfind('{');
+    if (open == std::string::npos || open + 2 >= line.size()) {
+        return 0;
+    }
+    std::size_t size = 0;
+    for (std::string::size_type i = open + 1; i + 1 < line.size(); ++i) {
+        if (line[i] < '0' || line[i] > '9') {
+            return 0;
+        }
+        size = size * 10 + static_cast<std::size_t>(line[i] - '0');
+    }
+    return size;
+}
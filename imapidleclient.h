@@ -0,0 +1,94 @@
+#ifndef IMAPIDLECLIENT_H
+#define IMAPIDLECLIENT_H
+
+#include <string>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include "asyncdialog.h"
+
+/*
+ * 基于 AsyncDialog 的 IMAP IDLE 长连接（RFC 2177）
+ *
+ * 连接、登录、SELECT 和 IDLE 都是异步的状态机，不占用线程，
+ * 多个账户的长连接共享 AsyncRuntime 的线程。
+ * 服务器会在 30 分钟无活动后断开，因此每 25 分钟用 DONE 结束并重新发出 IDLE，
+ * 连接断开后按 1 秒到 5 分钟的退避自动重连。
+ *
+ * 回调在 AsyncRuntime 的线程中执行。
+ */
+class ImapIdleClient : public std::enable_shared_from_this<ImapIdleClient>
+{
+public:
+    struct Settings {
+        enum Security { Plain, StartTls, Tls };
+
+        std::string host;
+        unsigned short port = 143;
+        Security security = Plain;
+        std::string user;
+        std::string password;
+        std::string folder = "INBOX";
+    };
+
+    // 邮箱中有邮件到达或被删除
+    using ChangeHandler = std::function<void(const std::string &folder)>;
+    // 进入或离开 IDLE 状态，离开时 reason 为原因
+    using StateHandler = std::function<void(bool active, const std::string &reason)>;
+
+    static std::shared_ptr<ImapIdleClient> create(const Settings &settings, ChangeHandler changed,
+                                                  StateHandler stateChanged,
+                                                  AsyncRuntime &runtime = AsyncRuntime::instance());
+
+    void start();
+    // 关闭连接并等待完成，返回后不会再有回调。不能在回调中调用
+    void stop();
+
+private:
+    ImapIdleClient(const Settings &settings, ChangeHandler changed, StateHandler stateChanged,
+                   AsyncRuntime &runtime);
+
+    using Done = std::function<void(bool ok, const std::string &line)>;
+
+    bool isCurrent(unsigned generation) const { return !m_stopped && generation == m_generation; }
+
+    void connect();
+    void readGreeting();
+    void login();
+    void command(const std::string &command, Done done);
+    void readTagged(const std::string &tag, Done done);
+    void enterIdle();
+    void readContinuation();
+    void readIdle();
+    void refreshIdle();
+    void handleUntagged(const std::string &line);
+    void fail(const std::string &reason);
+    void setActive(bool active, const std::string &reason = std::string());
+
+    static std::string quoted(const std::string &text);
+    static std::size_t literalSize(const std::string &line);
+
+    static constexpr std::chrono::seconds kTimeout{30};
+    static constexpr std::chrono::minutes kIdleRefresh{25};
+    static constexpr std::chrono::seconds kMaxBackoff{300};
+
+    const Settings m_settings;
+    const ChangeHandler m_changed;
+    const StateHandler m_stateChanged;
+    AsyncRuntime &m_runtime;
+
+    // 以下成员只在 m_strand 上访问
+    AsyncDialog::Strand m_strand;
+    std::shared_ptr<AsyncDialog> m_dialog;
+    boost::asio::steady_timer m_timer;       // 重连退避、IDLE 刷新和 DONE 的应答超时
+    std::chrono::seconds m_backoff{1};
+    std::string m_idleTag;
+    unsigned m_generation = 0;               // 每次重连加一，旧连接的回调据此丢弃
+    unsigned m_nextTag = 0;
+    bool m_active = false;
+    bool m_refreshing = false;
+    bool m_reconnecting = false;
+    bool m_stopped = false;
+};
+
+#endif // IMAPIDLECLIENT_H
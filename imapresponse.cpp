@@ -0,0 +1,215 @@
+#include "imapresponse.h"
+#include <algorithm>
+
+namespace {
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        char x = a[i], y = b[i];
+        if (x >= 'a' && x <= 'z') {
+            x = static_cast<char>(x - 'a' + 'A');
+        }
+        if (y >= 'a' && y <= 'z') {
+            y = static_cast<char>(y - 'a' + 'A');
+        }
+        if (x != y) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 行尾的 {n} 或 ~{n}，返回标记开始的位置，没有时返回 npos
+std::size_t literalMarker(std::string_view line, std::size_t &size)
+{
+    if (line.empty() || line.back() != '}') {
+        return std::string_view::npos;
+    }
+    const std::size_t open = line.rfind('{');
+    if (open == std::string_view::npos || open + 2 > line.size() - 1) {
+        return std::string_view::npos;
+    }
+    std::size_t value = 0;
+    for (std::size_t i = open + 1; i + 1 < line.size(); ++i) {
+        // RFC 7888 的非同步字面量 {n+}
+        if (line[i] == '+' && i + 2 == line.size()) {
+            break;
+        }
+        if (line[i] < '0' || line[i] > '9') {
+            return std::string_view::npos;
+        }
+        value = value * 10 + static_cast<std::size_t>(line[i] - '0');
+    }
+    size = value;
+    return open > 0 && line[open - 1] == '~' ? open - 1 : open;
+}
+
+} // namespace
+
+void ImapResponse::clear()
+{
+    m_text.clear();
+    m_tokens.clear();
+    m_open.clear();
+    m_literalRemaining = 0;
+}
+
+void ImapResponse::push(Token::Type type, std::size_t offset, std::size_t length)
+{
+    const auto index = static_cast<std::uint32_t>(m_tokens.size());
+    m_tokens.push_back({type, static_cast<std::uint32_t>(offset), static_cast<std::uint32_t>(length), index + 1});
+}
+
+void ImapResponse::closeList()
+{
+    Token &list = m_tokens[m_open.back()];
+    list.end = static_cast<std::uint32_t>(m_tokens.size());
+    m_open.pop_back();
+}
+
+bool ImapResponse::feedLine(std::string_view line, std::size_t &literalSize)
+{
+    const std::size_t from = m_text.size();
+    const std::size_t marker = literalMarker(line, literalSize);
+    m_text.append(line.substr(0, marker));
+    tokenize(from);
+
+    if (marker != std::string_view::npos) {
+        m_literalRemaining = literalSize;
+        push(Token::Literal, m_text.size(), literalSize);
+        return true;
+    }
+
+    // 响应结束，未闭合的列表（格式错误）延伸到末尾
+    while (!m_open.empty()) {
+        closeList();
+    }
+    return false;
+}
+
+void ImapResponse::feedLiteral(std::string_view chunk)
+{
+    const std::size_t count = std::min(chunk.size(), m_literalRemaining);
+    m_text.append(chunk.substr(0, count));
+    m_literalRemaining -= count;
+}
+
+void ImapResponse::skipLiteral()
+{
+    if (m_literalRemaining > 0 && !m_tokens.empty()) {
+        m_tokens.back().length = 0;
+        m_literalRemaining = 0;
+    }
+}
+
+void ImapResponse::tokenize(std::size_t from)
+{
+    const std::size_t size = m_text.size();
+    std::size_t i = from;
+    while (i < size) {
+        const char ch = m_text[i];
+        if (ch == ' ') {
+            ++i;
+        } else if (ch == '(') {
+            m_open.push_back(static_cast<std::uint32_t>(m_tokens.size()));
+            push(Token::List, i, 0);
+            ++i;
+        } else if (ch == ')') {
+            if (!m_open.empty()) {
+                Token &list = m_tokens[m_open.back()];
+                list.length = static_cast<std::uint32_t>(i + 1 - list.offset);
+                closeList();
+            }
+            ++i;
+        } else if (ch == '"') {
+            std::size_t j = i + 1;
+            while (j < size && m_text[j] != '"') {
+                j += m_text[j] == '\\' ? 2 : 1;
+            }
+            j = std::min(j, size);
+            push(Token::Quoted, i + 1, j - i - 1);
+            i = j + 1;
+        } else {
+            // 原子，其中 [...] 内可以有空格和括号
+            std::size_t j = i;
+            int depth = 0;
+            while (j < size) {
+                const char c = m_text[j];
+                if (c == '[') {
+                    ++depth;
+                } else if (c == ']' && depth > 0) {
+                    --depth;
+                } else if (depth == 0 && (c == ' ' || c == '(' || c == ')')) {
+                    break;
+                }
+                ++j;
+            }
+            const bool nil = equalsIgnoreCase(std::string_view(m_text).substr(i, j - i), "NIL");
+            push(nil ? Token::Nil : Token::Atom, i, j - i);
+            i = j;
+        }
+    }
+}
+
+std::string_view ImapResponse::view(int index) const
+{
+    const Token &t = token(index);
+    return std::string_view(m_text).substr(t.offset, t.length);
+}
+
+std::string ImapResponse::string(int index) const
+{
+    const std::string_view text = view(index);
+    if (token(index).type != Token::Quoted) {
+        return std::string(text);
+    }
+    std::string result;
+    result.reserve(text.size());
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\\' && i + 1 < text.size()) {
+            ++i;
+        }
+        result.push_back(text[i]);
+    }
+    return result;
+}
+
+bool ImapResponse::equals(int index, std::string_view atom) const
+{
+    return equalsIgnoreCase(view(index), atom);
+}
+
+unsigned long ImapResponse::number(int index) const
+{
+    unsigned long value = 0;
+    for (char ch : view(index)) {
+        if (ch < '0' || ch > '9') {
+            return 0;
+        }
+        value = value * 10 + static_cast<unsigned long>(ch - '0');
+    }
+    return value;
+}
+
+int ImapResponse::value(int list, std::string_view key, bool prefix) const
+{
+    const int end = next(list);
+    for (int i = list + 1; i < end;) {
+        const int valueIndex = next(i);
+        const std::string_view name = view(i);
+        const bool match = prefix ? name.size() >= key.size() && equalsIgnoreCase(name.substr(0, key.size()), key)
+                                  : equalsIgnoreCase(name, key);
+        if (match && token(i).type == Token::Atom) {
+            return valueIndex < end ? valueIndex : -1;
+        }
+        if (valueIndex >= end) {
+            break;
+        }
+        i = next(valueIndex);
+    }
+    return -1;
+}
@@ -0,0 +1,73 @@
+#ifndef IMAPRESPONSE_H
+#define IMAPRESPONSE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * IMAP 响应的扁平化词法分析
+ *
+ * mailio 把每个响应解析成 shared_ptr<response_token_t> 的链表树，每个记号带三个 std::string，
+ * 一次 100 封邮件的 FETCH 要分配上万个节点。ImapResponse 把响应文本（含字面量）
+ * 连续存放在一个缓冲区中，记号只记录偏移和长度，按先序放在一个数组里：
+ * 列表记号的 end 指向其最后一个后代之后的位置，跳过整个列表只需一步。
+ * clear() 保留容量，对象复用时解析不再分配内存。
+ *
+ * 覆盖 mailio 支持的语法：原子、带转义的引号字符串、{n} 与 ~{n} 字面量、NIL、
+ * 嵌套的圆括号列表，以及原子中的 [...] 节（如 BODY[HEADER.FIELDS (FROM)]）。
+ */
+class ImapResponse
+{
+public:
+    struct Token {
+        enum Type : std::uint8_t { Atom, Quoted, Literal, Nil, List };
+
+        Type type;
+        std::uint32_t offset;   // 在 text() 中的位置，引号字符串不含两端的引号
+        std::uint32_t length;
+        std::uint32_t end;      // 下一个兄弟记号的下标
+    };
+
+    ImapResponse() = default;
+
+    void clear();
+
+    // 送入一行（不含 CRLF）。返回 true 表示该行以字面量开头 {n} 结尾，
+    // 随后要用 feedLiteral() 送入恰好 literalSize 字节，再送入下一行
+    bool feedLine(std::string_view line, std::size_t &literalSize);
+    void feedLiteral(std::string_view chunk);
+    // 调用方直接读取了刚声明的字面量（如流式下载的附件），不存入 text()，该记号的长度记为 0
+    void skipLiteral();
+
+    const std::string &text() const { return m_text; }
+    int size() const { return static_cast<int>(m_tokens.size()); }
+    const Token &token(int index) const { return m_tokens[static_cast<std::size_t>(index)]; }
+    // 顶层记号从 0 开始，依次用 next() 遍历；列表的子记号从 index + 1 到 end
+    int next(int index) const { return static_cast<int>(token(index).end); }
+
+    std::string_view view(int index) const;
+    // 引号字符串去掉转义，其他记号同 view()
+    std::string string(int index) const;
+    bool equals(int index, std::string_view atom) const;
+    // 非数字时返回 0
+    unsigned long number(int index) const;
+
+    // 在形如 (KEY value KEY value ...) 的列表中查找键（不区分大小写），返回值记号的下标，找不到返回 -1。
+    // prefix 为 true 时只比较开头，用于 BODY[...] 之类带节的键
+    int value(int list, std::string_view key, bool prefix = false) const;
+
+private:
+    void tokenize(std::size_t from);
+    void push(Token::Type type, std::size_t offset, std::size_t length);
+    void closeList();
+
+    std::string m_text;
+    std::vector<Token> m_tokens;
+    std::vector<std::uint32_t> m_open;     // 尚未闭合的列表
+    std::size_t m_literalRemaining = 0;
+};
+
+#endif // IMAPRESPONSE_H
@@ -0,0 +1,516 @@
+#include "imapsession.h"
+#include "mimeview.h"
+#include <sstream>
+#include <boost/algorithm/string.hpp>
+#include <algorithm>
+
+namespace {
+
+bool startsWith(std::string_view line, std::string_view prefix)
+{
+    return line.substr(0, prefix.size()) == prefix;
+}
+
+// "* OK [UIDNEXT 4392] Predicted next UID" 中的数值，没有该响应码时返回 0
+unsigned long responseCode(std::string_view line, std::string_view code)
+{
+    const std::string key = "[" + std::string(code) + " ";
+    const std::string_view::size_type start = line.find(key);
+    if (start == std::string_view::npos) {
+        return 0;
+    }
+    unsigned long value = 0;
+    for (std::size_t i = start + key.size(); i < line.size() && line[i] >= '0' && line[i] <= '9'; ++i) {
+        value = value * 10 + static_cast<unsigned long>(line[i] - '0');
+    }
+    return value;
+}
+
+// "* 23 EXISTS" 中的邮件数量
+bool existsCount(std::string_view line, unsigned long &count)
+{
+    if (!startsWith(line, "* ") || line.size() < 9 || !boost::iequals(line.substr(line.size() - 7), " EXISTS")) {
+        return false;
+    }
+    count = 0;
+    for (std::size_t i = 2; i < line.size() - 7; ++i) {
+        if (line[i] < '0' || line[i] > '9') {
+            return false;
+        }
+        count = count * 10 + static_cast<unsigned long>(line[i] - '0');
+    }
+    return true;
+}
+
+std::string quoted(const std::string &text)
+{
+    std::string result = "\"";
+    for (char ch : text) {
+        if (ch == '"' || ch == '\\') {
+            result.push_back('\\');
+        }
+        result.push_back(ch);
+    }
+    result.push_back('"');
+    return result;
+}
+
+} // namespace
+
+ImapSession::~ImapSession()
+{
+    if (!m_deflate) {
+        return;
+    }
+    // mailio 的析构会以明文发送 LOGOUT，压缩连接上先自己发送，再关闭连接让那条发送失败
+    try {
+        sendCommand("LOGOUT");
+    } catch (const std::exception &) {
+    }
+    DialogIo::shutdown(*dlg_);
+}
+
+std::string ImapSession::sendCommand(const std::string &command)
+{
+    std::string line = format(command);
+    if (m_deflate) {
+        line += "\r\n";
+        const std::string_view compressed = m_deflate->deflate(line);
+        DialogIo::write(*dlg_, is_start_tls_, compressed);
+        m_traffic.wireOut += compressed.size();
+        m_traffic.dataOut += line.size();
+    } else {
+        dlg_->send(line);
+        m_traffic.wireOut += line.size() + 2;
+        m_traffic.dataOut += line.size() + 2;
+    }
+    return line.substr(0, line.find(TOKEN_SEPARATOR_CHAR));
+}
+
+LineReader &ImapSession::reader(std::optional<DialogLineReader> &scoped)
+{
+    if (m_inflatedReader) {
+        return *m_inflatedReader;
+    }
+    scoped.emplace(dlg_, is_start_tls_, &m_plainIn);
+    return *scoped;
+}
+
+ImapSession::Traffic ImapSession::takeTraffic()
+{
+    Traffic traffic = m_traffic;
+    traffic.wireIn += m_plainIn;
+    traffic.dataIn += m_plainIn;
+    m_traffic = Traffic();
+    m_plainIn = 0;
+    return traffic;
+}
+
+void ImapSession::readUntilTagged(const std::string &tag, const std::function<void(std::string_view line)> &untagged)
+{
+    const std::string tagPrefix = tag + TOKEN_SEPARATOR_STR;
+    std::optional<DialogLineReader> scoped;
+    LineReader &lines = reader(scoped);
+    while (true) {
+        const std::string_view line = lines.readLine();
+        if (startsWith(line, tagPrefix)) {
+            if (!boost::iequals(line.substr(tagPrefix.size(), 2), "OK")) {
+                throw mailio::imap_error("Command failure.", std::string(line));
+            }
+            return;
+        }
+        untagged(line);
+    }
+}
+
+void ImapSession::readResponses(const std::string &tag, const std::function<void()> &untagged)
+{
+    const std::string tagPrefix = tag + TOKEN_SEPARATOR_STR;
+    std::optional<DialogLineReader> scoped;
+    LineReader &lines = reader(scoped);
+    while (true) {
+        std::string_view line = lines.readLine();
+        if (startsWith(line, tagPrefix)) {
+            if (!boost::iequals(line.substr(tagPrefix.size(), 2), "OK")) {
+                throw mailio::imap_error("Command failure.", std::string(line));
+            }
+            return;
+        }
+
+        m_response.clear();
+        std::size_t literal = 0;
+        while (m_response.feedLine(line, literal)) {
+            lines.readLiteral(literal, [this](std::string_view chunk) {
+                m_response.feedLiteral(chunk);
+            });
+            line = lines.readLine();
+        }
+        untagged();
+    }
+}
+
+const std::vector<std::string> &ImapSession::capabilities()
+{
+    if (m_capabilitiesLoaded) {
+        return m_capabilities;
+    }
+
+    std::vector<std::string> result;
+    const std::string tag = sendCommand("CAPABILITY");
+    readUntilTagged(tag, [&result](std::string_view line) {
+        // * CAPABILITY IMAP4rev1 IDLE ...
+        std::istringstream tokens{std::string(line)};
+        std::string star, keyword, capability;
+        tokens >> star >> keyword;
+        if (star != UNTAGGED_RESPONSE || !boost::iequals(keyword, "CAPABILITY")) {
+            return;
+        }
+        while (tokens >> capability) {
+            result.push_back(boost::to_upper_copy(capability));
+        }
+    });
+
+    m_capabilities = std::move(result);
+    m_capabilitiesLoaded = true;
+    return m_capabilities;
+}
+
+bool ImapSession::hasCapability(const std::string &capability)
+{
+    const std::string wanted = boost::to_upper_copy(capability);
+    for (const std::string &cap : capabilities()) {
+        if (cap == wanted) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ImapSession::compress()
+{
+    if (m_deflate) {
+        return true;
+    }
+    if (!hasCapability("COMPRESS=DEFLATE")) {
+        return false;
+    }
+
+    const std::string tag = sendCommand("COMPRESS DEFLATE");
+    try {
+        readUntilTagged(tag, [](std::string_view) {});
+    } catch (const mailio::imap_error &) {
+        // NO 或 BAD：服务器拒绝，连接仍是明文
+        return false;
+    }
+
+    // 标签 OK 之后的数据都已压缩，和 OK 一起读入的部分留在 dialog 的缓冲区中
+    m_deflate = std::make_unique<DeflateStream>([this](char *data, std::size_t size) {
+        const std::size_t count = DialogIo::read(*dlg_, is_start_tls_, data, size);
+        m_traffic.wireIn += count;
+        return count;
+    });
+    m_deflate->pushCompressed(DialogIo::takeBuffered(*dlg_));
+    m_inflatedReader = std::make_unique<LineReader>([this](char *data, std::size_t size) {
+        const std::size_t count = m_deflate->inflate(data, size);
+        m_traffic.dataIn += count;
+        return count;
+    });
+    return true;
+}
+
+mailio::imap::mailbox_stat_t ImapSession::selectFolder(const std::string &mailbox)
+{
+    mailio::imap::mailbox_stat_t stat;
+    readUntilTagged(sendCommand("SELECT " + quoted(mailbox)), [&stat](std::string_view line) {
+        // * 172 EXISTS / * OK [UIDNEXT 4392] / * OK [UIDVALIDITY 3857529045]
+        unsigned long count = 0;
+        if (existsCount(line, count)) {
+            stat.messages_no = count;
+        } else if (const unsigned long uidNext = responseCode(line, "UIDNEXT")) {
+            stat.uid_next = uidNext;
+        } else if (const unsigned long uidValidity = responseCode(line, "UIDVALIDITY")) {
+            stat.uid_validity = uidValidity;
+        }
+    });
+    return stat;
+}
+
+bool ImapSession::noop()
+{
+    bool changed = false;
+    readUntilTagged(sendCommand("NOOP"), [&changed](std::string_view line) {
+        unsigned long count = 0;
+        if (existsCount(line, count)) {
+            changed = true;
+        }
+    });
+    return changed;
+}
+
+mailio::imap::mailbox_stat_t ImapSession::status(const std::string &mailbox)
+{
+    mailio::imap::mailbox_stat_t stat;
+    const std::string tag = sendCommand("STATUS " + quoted(mailbox) + " (UIDNEXT UIDVALIDITY)");
+    readResponses(tag, [this, &stat] {
+        // * STATUS "INBOX" (UIDNEXT 4392 UIDVALIDITY 1)
+        if (m_response.size() < 4 || !m_response.equals(0, UNTAGGED_RESPONSE) || !m_response.equals(1, "STATUS")) {
+            return;
+        }
+        const int list = m_response.next(2);
+        if (list >= m_response.size() || m_response.token(list).type != ImapResponse::Token::List) {
+            return;
+        }
+        const int uidNext = m_response.value(list, "UIDNEXT");
+        const int uidValidity = m_response.value(list, "UIDVALIDITY");
+        if (uidNext >= 0) {
+            stat.uid_next = m_response.number(uidNext);
+        }
+        if (uidValidity >= 0) {
+            stat.uid_validity = m_response.number(uidValidity);
+        }
+    });
+    return stat;
+}
+
+std::vector<unsigned long> ImapSession::searchUids(const std::string &criteria)
+{
+    std::vector<unsigned long> uids;
+    readResponses(sendCommand("UID SEARCH " + criteria), [this, &uids] {
+        // * SEARCH 2 84 882
+        if (m_response.size() < 2 || !m_response.equals(0, UNTAGGED_RESPONSE) || !m_response.equals(1, "SEARCH")) {
+            return;
+        }
+        for (int i = 2; i < m_response.size(); i = m_response.next(i)) {
+            if (m_response.token(i).type == ImapResponse::Token::Atom) {
+                uids.push_back(m_response.number(i));
+            }
+        }
+    });
+    std::sort(uids.begin(), uids.end());
+    return uids;
+}
+
+void ImapSession::fetchRaw(unsigned long uid, const RawSink &sink)
+{
+    if (!fetchLiteral("UID FETCH " + std::to_string(uid) + " BODY.PEEK[]", uid, std::string(), sink)) {
+        throw mailio::imap_error("Fetching message failure.", "No message with UID " + std::to_string(uid));
+    }
+}
+
+std::size_t ImapSession::fetchPart(unsigned long uid, const std::string &section, std::size_t offset,
+                                   std::size_t length, const RawSink &sink)
+{
+    std::string command = "UID FETCH " + std::to_string(uid) + " BODY.PEEK[" + section + "]";
+    if (length > 0) {
+        command += '<' + std::to_string(offset) + '.' + std::to_string(length) + '>';
+    }
+    return fetchLiteral(command, uid, section, sink).value_or(0);
+}
+
+std::optional<std::size_t> ImapSession::fetchLiteral(const std::string &command, unsigned long uid,
+                                                     const std::string &section, const RawSink &sink)
+{
+    const std::string tag = sendCommand(command);
+    const std::string tagPrefix = tag + TOKEN_SEPARATOR_STR;
+    const std::string key = "BODY[" + section + "]";
+    std::optional<std::size_t> received;
+
+    std::optional<DialogLineReader> scoped;
+    LineReader &lines = reader(scoped);
+    while (true) {
+        std::string_view line = lines.readLine();
+        if (startsWith(line, tagPrefix)) {
+            if (!boost::iequals(line.substr(tagPrefix.size(), 2), "OK")) {
+                throw mailio::imap_error("Fetching message failure.", std::string(line));
+            }
+            break;
+        }
+
+        // * 12 FETCH (UID 345 BODY[2] {2048}
+        // 每个响应都按 ImapResponse 的语法解析，字面量总是整块读完，不会被当作响应行。
+        // 只有请求的那一个字面量直接交给 sink，其余的存入 m_response 后随响应丢弃
+        m_response.clear();
+        bool streamed = false;
+        std::size_t literal = 0;
+        while (m_response.feedLine(line, literal)) {
+            if (!received && isRequestedLiteral(uid, key)) {
+                received = literal;
+                streamed = true;
+                lines.readLiteral(literal, [&sink, literal](std::string_view chunk) {
+                    sink(chunk, literal);
+                });
+                m_response.skipLiteral();
+            } else {
+                lines.readLiteral(literal, [this](std::string_view chunk) {
+                    m_response.feedLiteral(chunk);
+                });
+            }
+            line = lines.readLine();
+        }
+
+        // UID 在数据之后才出现时到这里才能核对，数据已交给 sink，只能报错
+        if (streamed) {
+            const int uidValue = m_response.value(3, "UID");
+            if (uidValue >= 0 && m_response.number(uidValue) != uid) {
+                throw mailio::imap_error("Fetching message failure.", "Unexpected FETCH response.");
+            }
+        }
+    }
+    return received;
+}
+
+bool ImapSession::isRequestedLiteral(unsigned long uid, std::string_view key) const
+{
+    if (m_response.size() < 6 || !m_response.equals(0, UNTAGGED_RESPONSE) || !m_response.equals(2, "FETCH")
+        || m_response.token(3).type != ImapResponse::Token::List) {
+        return false;
+    }
+    // FETCH 列表还没有闭合，按键值对逐个跳过，直到字面量所在的位置
+    const int literal = m_response.size() - 1;
+    for (int name = 4; name < literal;) {
+        const int value = m_response.next(name);
+        if (value == literal) {
+            const std::string_view item = m_response.view(name);
+            // BODY[2] 或部分下载时的 BODY[2]<0>
+            return item.size() >= key.size() && boost::iequals(item.substr(0, key.size()), key)
+                && (item.size() == key.size() || item[key.size()] == '<');
+        }
+        const ImapResponse::Token &token = m_response.token(value);
+        // 尚未闭合的子列表说明字面量在更深的层次中（如 ENVELOPE 里的字符串）
+        if (token.type == ImapResponse::Token::List && token.length == 0) {
+            return false;
+        }
+        if (m_response.equals(name, "UID") && m_response.number(value) != uid) {
+            return false;
+        }
+        name = m_response.next(value);
+    }
+    return false;
+}
+
+std::vector<ImapSession::BodyPart> ImapSession::fetchStructure(unsigned long uid)
+{
+    std::vector<BodyPart> parts;
+    const std::string tag = sendCommand("UID FETCH " + std::to_string(uid) + " (UID BODYSTRUCTURE)");
+    readResponses(tag, [this, &parts] {
+        // * 12 FETCH (UID 345 BODYSTRUCTURE (("TEXT" "PLAIN" ...) ... "MIXED"))
+        if (m_response.size() < 4 || !m_response.equals(0, UNTAGGED_RESPONSE) || !m_response.equals(2, "FETCH")
+            || m_response.token(3).type != ImapResponse::Token::List) {
+            return;
+        }
+        const int body = m_response.value(3, "BODYSTRUCTURE");
+        if (body < 0 || m_response.token(body).type != ImapResponse::Token::List || !parts.empty()) {
+            return;
+        }
+        parseStructure(body, std::string(), parts);
+    });
+    return parts;
+}
+
+void ImapSession::parseStructure(int body, const std::string &section, std::vector<BodyPart> &parts) const
+{
+    const int end = m_response.next(body);
+    int field = body + 1;
+
+    // multipart：子部分依次编号，其后的子类型和扩展数据不需要
+    if (field < end && m_response.token(field).type == ImapResponse::Token::List) {
+        int number = 1;
+        for (; field < end && m_response.token(field).type == ImapResponse::Token::List;
+             field = m_response.next(field), ++number) {
+            const std::string child = std::to_string(number);
+            parseStructure(field, section.empty() ? child : section + '.' + child, parts);
+        }
+        return;
+    }
+
+    // 单个部分：type subtype (params) id description encoding size [扩展数据]
+    std::vector<int> fields;
+    for (; field < end; field = m_response.next(field)) {
+        fields.push_back(field);
+    }
+    if (fields.size() < 7) {
+        return;
+    }
+
+    BodyPart part;
+    // 非 multipart 的邮件只有一个部分，节号为 1
+    part.section = section.empty() ? "1" : section;
+    part.mediaType = boost::algorithm::to_lower_copy(m_response.string(fields[0]) + '/' + m_response.string(fields[1]));
+    const auto typeParams = parameters(fields[2]);
+    part.charset = boost::algorithm::to_lower_copy(MimeView::combineParameter(typeParams, "charset"));
+    part.encoding = boost::algorithm::to_lower_copy(m_response.string(fields[5]));
+    part.size = m_response.number(fields[6]);
+
+    // 扩展数据先是 MD5，再是 disposition；text 在此之前多一个行数，
+    // message/rfc822 多 envelope、body 和行数
+    std::size_t dispositionField = 8;
+    if (part.mediaType.compare(0, 5, "text/") == 0) {
+        dispositionField = 9;
+    } else if (part.mediaType == "message/rfc822" || part.mediaType == "message/global") {
+        dispositionField = 11;
+    }
+
+    // ("ATTACHMENT" ("FILENAME" "a.pdf"))
+    std::string disposition;
+    std::vector<std::pair<std::string, std::string>> dispositionParams;
+    if (dispositionField < fields.size() && m_response.token(fields[dispositionField]).type == ImapResponse::Token::List) {
+        const int list = fields[dispositionField];
+        const int type = list + 1;
+        if (type < m_response.next(list)) {
+            disposition = boost::algorithm::to_lower_copy(m_response.string(type));
+            const int params = m_response.next(type);
+            if (params < m_response.next(list)) {
+                dispositionParams = parameters(params);
+            }
+        }
+    }
+
+    part.fileName = MimeView::combineParameter(dispositionParams, "filename", &part.fileNameCharset);
+    if (part.fileName.empty()) {
+        part.fileName = MimeView::combineParameter(typeParams, "name", &part.fileNameCharset);
+    }
+    if (disposition == "attachment") {
+        part.attachment = true;
+    } else if (disposition == "inline" && part.mediaType.compare(0, 5, "text/") == 0) {
+        part.attachment = false;
+    } else {
+        part.attachment = !part.fileName.empty();
+    }
+    parts.push_back(std::move(part));
+}
+
+std::vector<std::pair<std::string, std::string>> ImapSession::parameters(int list) const
+{
+    std::vector<std::pair<std::string, std::string>> params;
+    if (m_response.token(list).type != ImapResponse::Token::List) {
+        return params;
+    }
+    const int end = m_response.next(list);
+    for (int key = list + 1; key < end;) {
+        const int value = m_response.next(key);
+        if (value >= end) {
+            break;
+        }
+        params.emplace_back(boost::algorithm::to_lower_copy(m_response.string(key)), m_response.string(value));
+        key = m_response.next(value);
+    }
+    return params;
+}
+
+void ImapSession::fetchHeaders(const std::string &uidSet, const HeaderHandler &handler)
+{
+    const std::string tag = sendCommand("UID FETCH " + uidSet + " (UID BODY.PEEK[HEADER])");
+    readResponses(tag, [this, &handler] {
+        // * 12 FETCH (UID 345 BODY[HEADER] {342}
+        if (m_response.size() < 4 || !m_response.equals(0, UNTAGGED_RESPONSE) || !m_response.equals(2, "FETCH")
+            || m_response.token(3).type != ImapResponse::Token::List) {
+            return;
+        }
+        const int uid = m_response.value(3, "UID");
+        const int header = m_response.value(3, "BODY[", true);
+        if (uid < 0 || header < 0 || m_response.token(header).type == ImapResponse::Token::Nil) {
+            return;
+        }
+        handler(m_response.number(uid), m_response.view(header));
+    });
+}
@@ -0,0 +1,133 @@
+#ifndef IMAPSESSION_H
+#define IMAPSESSION_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <string_view>
+#include <memory>
+#include <optional>
+#include <cstdint>
+#include "libs/mailio/include/imap.hpp"
+#include "imapresponse.h"
+#include "linereader.h"
+#include "deflatestream.h"
+
+/*
+ * mailio::imap 的扩展
+ *
+ * mailio 以预编译库的形式提供，这里通过继承使用其受保护的 dlg_ 和 format()
+ * 发送库本身不支持的命令（CAPABILITY 等）。
+ *
+ * compress() 开启 COMPRESS=DEFLATE 后连接上的数据都经过压缩，mailio 自己的
+ * select()、statistics()、search() 等方法不再可用，要改用这里的 selectFolder()、
+ * status()、searchUids()。
+ */
+class ImapSession : public mailio::imap
+{
+public:
+    // 原始数据的接收者，total 为本次响应中数据（整封邮件或部分）的总字节数
+    using RawSink = std::function<void(std::string_view chunk, std::size_t total)>;
+    // 一封邮件的头部，header 只在回调期间有效
+    using HeaderHandler = std::function<void(unsigned long uid, std::string_view header)>;
+
+    // BODYSTRUCTURE 中的一个叶子部分，multipart 本身不列出
+    struct BodyPart {
+        std::string section;          // FETCH 使用的节号，如 "1"、"2.1"
+        std::string mediaType;        // 小写，如 "application/pdf"
+        std::string charset;          // 小写
+        std::string encoding;         // Content-Transfer-Encoding，小写
+        std::size_t size = 0;         // 传输编码后的字节数
+        std::string fileName;         // 附件名，可能仍是 RFC 2047 编码字
+        std::string fileNameCharset;  // RFC 2231 形式的文件名声明的字符集
+        bool attachment = false;      // 判断规则与 MimeView::isAttachment() 相同
+    };
+
+    // 本会话收发的字节数。wire 是连接上实际传输的（TLS 之下、压缩之后），
+    // data 是压缩前的 IMAP 数据，未开启压缩时两者相同
+    struct Traffic {
+        std::uint64_t wireIn = 0;
+        std::uint64_t wireOut = 0;
+        std::uint64_t dataIn = 0;
+        std::uint64_t dataOut = 0;
+    };
+
+    using mailio::imap::imap;
+    ~ImapSession() override;
+
+    // 底层连接，其他线程可用 DialogIo::shutdown() 关闭它，打断阻塞中的读取
+    std::weak_ptr<mailio::dialog> connection() const { return dlg_; }
+
+    // 查询服务器能力（CAPABILITY），结果会缓存
+    const std::vector<std::string> &capabilities();
+    bool hasCapability(const std::string &capability);
+
+    // 服务器支持 COMPRESS=DEFLATE 时开启压缩（RFC 4978），应在认证之后调用。
+    // 返回压缩是否已开启；服务器拒绝时返回 false，连接照常可用
+    bool compress();
+    bool isCompressed() const { return m_deflate != nullptr; }
+
+    // SELECT，压缩开启后代替 mailio::imap::select()。
+    // 返回响应中的 EXISTS（messages_no）、UIDNEXT 和 UIDVALIDITY
+    mailio::imap::mailbox_stat_t selectFolder(const std::string &mailbox);
+    // STATUS mailbox (UIDNEXT UIDVALIDITY)，只填写 uid_next 和 uid_validity。
+    // 不要对已选中的文件夹使用（RFC 3501 6.3.10），那时改用 noop()
+    mailio::imap::mailbox_stat_t status(const std::string &mailbox);
+    // NOOP，返回服务器是否报告了 EXISTS（已选中文件夹的邮件数量有变化）
+    bool noop();
+    // UID SEARCH，criteria 为 "ALL"、"UID 100:*" 等，返回升序的 UID
+    std::vector<unsigned long> searchUids(const std::string &criteria);
+
+    // 取出上次调用以来的流量并清零
+    Traffic takeTraffic();
+
+    // 以流的方式取回整封邮件（UID FETCH BODY.PEEK[]），不经过 mailio 的 MIME 解析，
+    // 不设置 \Seen 标记。数据按块交给 sink，邮件不存在时抛出 imap_error
+    void fetchRaw(unsigned long uid, const RawSink &sink);
+
+    // 批量取回邮件头（UID FETCH set (UID BODY.PEEK[HEADER])），不设置 \Seen 标记。
+    // uidSet 为 "1:5,9" 形式；响应由 ImapResponse 解析，不经过 mailio 的解析器
+    void fetchHeaders(const std::string &uidSet, const HeaderHandler &handler);
+
+    // 取回邮件结构（UID FETCH BODYSTRUCTURE），按节号顺序列出所有叶子部分，
+    // 不下载任何正文。邮件不存在时返回空列表
+    std::vector<BodyPart> fetchStructure(unsigned long uid);
+    // 取回一个部分未解码的内容（UID FETCH BODY.PEEK[section]<offset.length>），不设置 \Seen 标记。
+    // offset、length 是传输编码后的字节范围，length 为 0 时取整个部分。
+    // 返回收到的字节数，offset 超出部分末尾时为 0
+    std::size_t fetchPart(unsigned long uid, const std::string &section, std::size_t offset,
+                          std::size_t length, const RawSink &sink);
+
+protected:
+    // 发送带标签的命令，返回该命令的标签
+    std::string sendCommand(const std::string &command);
+    // 读取到该标签的结束行为止，未带标签的响应行交给 untagged 处理
+    void readUntilTagged(const std::string &tag, const std::function<void(std::string_view line)> &untagged);
+    // 同上，每个未带标签的响应（含字面量）解析到 m_response 后调用 untagged
+    void readResponses(const std::string &tag, const std::function<void()> &untagged);
+    // 发送 FETCH 命令，把邮件 uid 的 BODY[section] 按块交给 sink（字面量不经过 m_response 缓存），
+    // 返回其字节数；响应中没有该数据（NIL）时返回 std::nullopt。
+    // 其他未带标签的响应（如服务器主动发送的 FETCH）照常完整解析后丢弃
+    std::optional<std::size_t> fetchLiteral(const std::string &command, unsigned long uid,
+                                            const std::string &section, const RawSink &sink);
+    // m_response 正在解析的 FETCH 响应中，刚声明的字面量是否是邮件 uid 的 key（如 "BODY[1]"）的值。
+    // 只看 FETCH 列表的顶层，字面量之前出现的 UID 必须等于 uid
+    bool isRequestedLiteral(unsigned long uid, std::string_view key) const;
+    // 解析 m_response 中下标为 body 的 BODYSTRUCTURE 列表，section 为该部分的节号（顶层为空）
+    void parseStructure(int body, const std::string &section, std::vector<BodyPart> &parts) const;
+    // (key value ...) 形式的参数表，键转为小写，NIL 返回空表
+    std::vector<std::pair<std::string, std::string>> parameters(int list) const;
+    // 压缩开启后返回常驻的解压读取器，否则在 scoped 中构造直接读取连接的读取器
+    LineReader &reader(std::optional<DialogLineReader> &scoped);
+
+    ImapResponse m_response;   // 复用以避免每个响应重新分配
+    std::vector<std::string> m_capabilities;
+    bool m_capabilitiesLoaded = false;
+
+    std::unique_ptr<DeflateStream> m_deflate;
+    std::unique_ptr<LineReader> m_inflatedReader;   // 解压后的数据跨命令保留
+    Traffic m_traffic;
+    std::uint64_t m_plainIn = 0;                     // 未压缩时读到的字节数
+};
+
+#endif // IMAPSESSION_H
@@ -0,0 +1,182 @@
+#include "linereader.h"
+#include <cstring>
+#include <algorithm>
+#ifndef _WIN32
+#include <sys/socket.h>
+#endif
+
+namespace {
+
+// mailio::dialog 的连接和缓冲区是受保护成员，借助成员指针取得
+struct DialogAccess : mailio::dialog_ssl
+{
+    static boost::asio::ip::tcp::socket &socket(mailio::dialog &dialog)
+    {
+        return *(dialog.*(&DialogAccess::socket_));
+    }
+
+    static boost::asio::ssl::stream<boost::asio::ip::tcp::socket&> &sslSocket(mailio::dialog &dialog)
+    {
+        return *(static_cast<mailio::dialog_ssl &>(dialog).*(&DialogAccess::ssl_socket_));
+    }
+
+    static boost::asio::streambuf &buffer(mailio::dialog &dialog)
+    {
+        return *(dialog.*(&DialogAccess::strmbuf_));
+    }
+};
+
+template<typename Stream>
+std::size_t readSome(Stream &stream, char *data, std::size_t size)
+{
+    boost::system::error_code error;
+    const std::size_t count = stream.read_some(boost::asio::buffer(data, size), error);
+    if (error) {
+        throw mailio::dialog_error("Network receiving error.", error.message());
+    }
+    return count;
+}
+
+template<typename Stream>
+void writeAll(Stream &stream, std::string_view data)
+{
+    boost::system::error_code error;
+    boost::asio::write(stream, boost::asio::buffer(data.data(), data.size()), error);
+    if (error) {
+        throw mailio::dialog_error("Network sending error.", error.message());
+    }
+}
+
+} // namespace
+
+LineReader::LineReader(Source source)
+    : m_source(std::move(source))
+    , m_buffer(kChunkSize)
+{
+}
+
+void LineReader::append(std::string_view data)
+{
+    if (m_buffer.size() - m_end < data.size()) {
+        m_buffer.resize(m_end + data.size());
+    }
+    std::memcpy(m_buffer.data() + m_end, data.data(), data.size());
+    m_end += data.size();
+}
+
+void LineReader::fill()
+{
+    // 已消费的部分超过一半时前移，避免缓冲区无限增长
+    if (m_begin > 0 && (m_begin == m_end || m_begin >= m_buffer.size() / 2)) {
+        std::memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+        m_end -= m_begin;
+        m_scanned -= m_begin;
+        m_begin = 0;
+    }
+    // 超长的行需要更大的缓冲区
+    if (m_buffer.size() - m_end < kChunkSize / 4) {
+        m_buffer.resize(m_buffer.size() * 2);
+    }
+    m_end += m_source(m_buffer.data() + m_end, m_buffer.size() - m_end);
+}
+
+std::string_view LineReader::readLine()
+{
+    m_scanned = std::max(m_scanned, m_begin);
+    while (true) {
+        const char *start = m_buffer.data() + m_scanned;
+        const char *newline = static_cast<const char *>(std::memchr(start, '\n', m_end - m_scanned));
+        if (newline) {
+            const std::size_t lineStart = m_begin;
+            std::size_t lineEnd = static_cast<std::size_t>(newline - m_buffer.data());
+            m_begin = lineEnd + 1;
+            m_scanned = m_begin;
+            if (lineEnd > lineStart && m_buffer[lineEnd - 1] == '\r') {
+                --lineEnd;
+            }
+            return std::string_view(m_buffer.data() + lineStart, lineEnd - lineStart);
+        }
+        m_scanned = m_end;
+        fill();
+    }
+}
+
+void LineReader::readLiteral(std::size_t size, const Sink &sink)
+{
+    while (size > 0) {
+        if (m_begin == m_end) {
+            // 缓冲区已空，直接按块读入，每块只读到字面量结尾为止
+            m_begin = m_end = m_scanned = 0;
+            m_end = m_source(m_buffer.data(), std::min(size, m_buffer.size()));
+        }
+        const std::size_t count = std::min(size, m_end - m_begin);
+        sink(std::string_view(m_buffer.data() + m_begin, count));
+        m_begin += count;
+        size -= count;
+    }
+}
+
+DialogLineReader::DialogLineReader(const std::shared_ptr<mailio::dialog> &dialog, bool ssl, std::uint64_t *received)
+    : LineReader([dialog, ssl, received](char *data, std::size_t size) {
+          const std::size_t count = DialogIo::read(*dialog, ssl, data, size);
+          if (received) {
+              *received += count;
+          }
+          return count;
+      })
+    , m_dialog(dialog)
+{
+    boost::asio::streambuf &buffer = DialogAccess::buffer(*m_dialog);
+    const auto data = buffer.data();
+    append(std::string_view(static_cast<const char *>(data.data()), data.size()));
+    buffer.consume(data.size());
+}
+
+DialogLineReader::~DialogLineReader()
+{
+    const std::string_view rest = pending();
+    if (rest.empty()) {
+        return;
+    }
+    boost::asio::streambuf &buffer = DialogAccess::buffer(*m_dialog);
+    const auto space = buffer.prepare(rest.size());
+    std::memcpy(space.data(), rest.data(), rest.size());
+    buffer.commit(rest.size());
+}
+
+std::size_t DialogIo::read(mailio::dialog &dialog, bool ssl, char *data, std::size_t size)
+{
+    return ssl ? readSome(DialogAccess::sslSocket(dialog), data, size)
+               : readSome(DialogAccess::socket(dialog), data, size);
+}
+
+void DialogIo::write(mailio::dialog &dialog, bool ssl, std::string_view data)
+{
+    if (ssl) {
+        writeAll(DialogAccess::sslSocket(dialog), data);
+    } else {
+        writeAll(DialogAccess::socket(dialog), data);
+    }
+}
+
+std::string DialogIo::takeBuffered(mailio::dialog &dialog)
+{
+    boost::asio::streambuf &buffer = DialogAccess::buffer(dialog);
+    const auto data = buffer.data();
+    std::string result(static_cast<const char *>(data.data()), data.size());
+    buffer.consume(data.size());
+    return result;
+}
+
+void DialogIo::shutdown(mailio::dialog &dialog)
+{
+    // 按 Asio 的规则，另一个线程正在 read_some 时不能调用同一 socket 对象的成员函数。
+    // 直接对原生句柄调用系统的 shutdown()，这个系统调用可以与阻塞中的 recv() 并发，
+    // 并让那次读取立即返回；socket 对象本身的状态不受影响，之后由所属线程照常关闭
+    const auto handle = DialogAccess::socket(dialog).native_handle();
+#ifdef _WIN32
+    ::shutdown(handle, SD_BOTH);
+#else
+    ::shutdown(handle, SHUT_RDWR);
+#endif
+}
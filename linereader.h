@@ -0,0 +1,92 @@
+#ifndef LINEREADER_H
+#define LINEREADER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include "libs/mailio/include/dialog.hpp"
+
+/*
+ * 按块读取的行缓冲
+ *
+ * mailio::dialog::receive() 每次通过 streambuf 和 istream 读一行并返回新的 std::string，
+ * 取回一封 20MB 的邮件就是几十万次小分配。LineReader 一次读入一大块到可复用的缓冲区，
+ * 用 memchr 查找行尾，行以 string_view 返回；IMAP 的 {n} 字面量整块交给调用方，不再按行拆分。
+ *
+ * 返回的 string_view 指向内部缓冲区，在下一次读取前有效。
+ */
+class LineReader
+{
+public:
+    // 至少读入 1 个字节并返回字节数，连接出错或关闭时抛出异常
+    using Source = std::function<std::size_t(char *data, std::size_t size)>;
+    using Sink = std::function<void(std::string_view chunk)>;
+
+    static const std::size_t kChunkSize = 64 * 1024;
+
+    explicit LineReader(Source source);
+    virtual ~LineReader() = default;
+
+    LineReader(const LineReader&) = delete;
+    LineReader& operator=(const LineReader&) = delete;
+
+    // 读取一行，不含结尾的 CRLF（或单独的 LF）
+    std::string_view readLine();
+    // 读取恰好 size 字节，分成尽量大的块交给 sink
+    void readLiteral(std::size_t size, const Sink &sink);
+
+protected:
+    // 已读入但未消费的数据
+    std::string_view pending() const { return std::string_view(m_buffer.data() + m_begin, m_end - m_begin); }
+    void append(std::string_view data);
+
+private:
+    void fill();
+
+    Source m_source;
+    std::vector<char> m_buffer;
+    std::size_t m_begin = 0;
+    std::size_t m_end = 0;
+    std::size_t m_scanned = 0;   // [m_begin, m_scanned) 中没有换行符
+};
+
+/*
+ * 直接读取 mailio 会话底层连接的 LineReader
+ *
+ * 构造时接管 dialog 内部 streambuf 中已缓存的数据，析构时把未消费的数据放回，
+ * 之后 mailio 自己的 receive() 仍能接着读。读取不受 dialog 的超时设置约束，
+ * 与不设超时的 IMAP、POP3 会话行为一致，需要放弃时用 DialogIo::shutdown() 打断。
+ * ssl 表示该 dialog 已切换为 TLS（调用过 start_tls 的会话）。
+ * received 不为空时累加从连接读到的字节数。
+ */
+class DialogLineReader : public LineReader
+{
+public:
+    DialogLineReader(const std::shared_ptr<mailio::dialog> &dialog, bool ssl, std::uint64_t *received = nullptr);
+    ~DialogLineReader() override;
+
+private:
+    std::shared_ptr<mailio::dialog> m_dialog;
+};
+
+/*
+ * 绕过 dialog 的 streambuf 直接读写底层连接，用于 mailio 不支持的传输层（如 COMPRESS）。
+ * 出错时抛出 mailio::dialog_error
+ */
+namespace DialogIo {
+
+// 至少读入 1 个字节
+std::size_t read(mailio::dialog &dialog, bool ssl, char *data, std::size_t size);
+void write(mailio::dialog &dialog, bool ssl, std::string_view data);
+// 取走 dialog 的 streambuf 中已读入但未消费的数据
+std::string takeBuffered(mailio::dialog &dialog);
+// 关闭连接，之后 mailio 的读写都会失败。可以在其他线程调用，阻塞中的读取随即返回错误
+void shutdown(mailio::dialog &dialog);
+
+} // namespace DialogIo
+
+#endif // LINEREADER_H
@@ -0,0 +1,175 @@
+#include "mailboxmodel.h"
+#include <algorithm>
+
+MailboxModel::MailboxModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int MailboxModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(m_emails.size());
+}
+
+QVariant MailboxModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= m_emails.size()) {
+        return QVariant();
+    }
+
+    const Email &email = m_emails.at(slotForRow(index.row()));
+    switch (role) {
+    case Qt::DisplayRole:
+        return QString("%1\n%2").arg(email.sender, email.subject);
+    case Qt::ToolTipRole:
+        return email.sendError.isEmpty() ? email.subject : QString("%1\n%2").arg(email.subject, email.sendError);
+    case IdRole:
+        return email.id;
+    case SenderRole:
+        return email.sender;
+    case SubjectRole:
+        return email.subject;
+    case TimeRole:
+        return email.time;
+    case ReadRole:
+        return email.isRead;
+    case FavoriteRole:
+        return email.isFavorite;
+    case AttachmentRole:
+        return !email.attachments.isEmpty();
+    case SendStateRole:
+        return email.sendState;
+    default:
+        return QVariant();
+    }
+}
+
+void MailboxModel::setEmails(const QList<Email> &emails)
+{
+    beginResetModel();
+    m_emails.clear();
+    m_emails.reserve(emails.size());
+    for (auto it = emails.crbegin(); it != emails.crend(); ++it) {
+        m_emails.append(*it);
+    }
+    rebuildIndex();
+    endResetModel();
+}
+
+void MailboxModel::clear()
+{
+    beginResetModel();
+    m_emails.clear();
+    m_index.clear();
+    endResetModel();
+}
+
+bool MailboxModel::prependEmail(const Email &email)
+{
+    if (m_index.contains(key(email))) {
+        return false;
+    }
+
+    beginInsertRows(QModelIndex(), 0, 0);
+    m_index.insert(key(email), static_cast<int>(m_emails.size()));
+    m_emails.append(email);
+    endInsertRows();
+    return true;
+}
+
+bool MailboxModel::insertEmail(const Email &email)
+{
+    if (m_index.contains(key(email))) {
+        return false;
+    }
+
+    // m_emails 从旧到新，时间相同的排在已有邮件之后（显示在其上方）
+    const auto it = std::upper_bound(m_emails.cbegin(), m_emails.cend(), email.time,
+                                     [](const QDateTime &time, const Email &other) {
+        return time < other.time;
+    });
+    const int slot = static_cast<int>(it - m_emails.cbegin());
+    const int row = static_cast<int>(m_emails.size()) - slot;
+    beginInsertRows(QModelIndex(), row, row);
+    m_emails.insert(slot, email);
+    // 新邮件通常是最新的，插在末尾时不需要移动索引
+    for (int i = slot; i < m_emails.size(); ++i) {
+        m_index[key(m_emails.at(i))] = i;
+    }
+    endInsertRows();
+    return true;
+}
+
+bool MailboxModel::removeEmail(const QString &account, const QString &id)
+{
+    auto it = m_index.constFind(key(account, id));
+    if (it == m_index.constEnd()) {
+        return false;
+    }
+
+    const int slot = it.value();
+    const int row = rowForSlot(slot);
+    beginRemoveRows(QModelIndex(), row, row);
+    m_emails.removeAt(slot);
+    // 只有其后的元素位置发生变化
+    m_index.remove(key(account, id));
+    for (int i = slot; i < m_emails.size(); ++i) {
+        m_index[key(m_emails.at(i))] = i;
+    }
+    endRemoveRows();
+    return true;
+}
+
+int MailboxModel::removeIf(const std::function<bool(const Email &email)> &predicate)
+{
+    const int before = static_cast<int>(m_emails.size());
+    QList<Email> kept;
+    kept.reserve(before);
+    for (const Email &email : std::as_const(m_emails)) {
+        if (!predicate(email)) {
+            kept.append(email);
+        }
+    }
+    if (kept.size() == before) {
+        return 0;
+    }
+
+    beginResetModel();
+    m_emails = std::move(kept);
+    rebuildIndex();
+    endResetModel();
+    return before - static_cast<int>(m_emails.size());
+}
+
+Email *MailboxModel::find(const QString &account, const QString &id)
+{
+    auto it = m_index.constFind(key(account, id));
+    return it == m_index.constEnd() ? nullptr : &m_emails[it.value()];
+}
+
+Email *MailboxModel::emailAt(int row)
+{
+    if (row < 0 || row >= m_emails.size()) {
+        return nullptr;
+    }
+    return &m_emails[slotForRow(row)];
+}
+
+void MailboxModel::emailChanged(const QString &account, const QString &id)
+{
+    auto it = m_index.constFind(key(account, id));
+    if (it == m_index.constEnd()) {
+        return;
+    }
+    const QModelIndex changed = index(rowForSlot(it.value()));
+    emit dataChanged(changed, changed);
+}
+
+void MailboxModel::rebuildIndex()
+{
+    m_index.clear();
+    m_index.reserve(m_emails.size());
+    for (int i = 0; i < m_emails.size(); ++i) {
+        m_index.insert(key(m_emails.at(i)), i);
+    }
+}
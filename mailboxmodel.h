@@ -0,0 +1,69 @@
+#ifndef MAILBOXMODEL_H
+#define MAILBOXMODEL_H
+
+#include <QAbstractListModel>
+#include <QList>
+#include <QHash>
+#include <functional>
+#include "accountdialog.h"  // 包含 Email 定义
+
+/*
+ * 邮件列表模型
+ *
+ * 邮件按时间从旧到新保存在 m_emails 中，第 0 行对应最后一个元素，
+ * 新邮件只需追加到末尾并通知插入第 0 行，不会移动已有数据；
+ * 统一收件箱用 insertEmail 按时间二分插入，较早的邮件才需要移动其后的元素。
+ * m_index 记录 (账户, id) 到存储位置的映射，查找和单行更新都是 O(1)。
+ * 统一收件箱中不同账户的邮件 id 可能相同，因此总是连同账户一起查找。
+ * 只能在 GUI 线程中使用。
+ */
+class MailboxModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles {
+        IdRole = Qt::UserRole,
+        SenderRole,
+        SubjectRole,
+        TimeRole,
+        ReadRole,
+        FavoriteRole,
+        AttachmentRole,
+        SendStateRole
+    };
+
+    explicit MailboxModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    // 整体替换，emails 按从新到旧排列（与 MailStore::loadEmails 一致）
+    void setEmails(const QList<Email> &emails);
+    void clear();
+
+    // 新邮件显示在最前面，同一账户的 id 已存在时返回 false
+    bool prependEmail(const Email &email);
+    // 按时间插入到对应位置（二分查找），用于合并多个账户的统一收件箱，
+    // 要求已有邮件按时间排列。同一账户的 id 已存在时返回 false
+    bool insertEmail(const Email &email);
+    bool removeEmail(const QString &account, const QString &id);
+    int removeIf(const std::function<bool(const Email &email)> &predicate);
+
+    // 返回的指针在下一次插入或删除前有效，修改后需调用 emailChanged
+    Email *find(const QString &account, const QString &id);
+    Email *emailAt(int row);
+    void emailChanged(const QString &account, const QString &id);
+
+private:
+    int rowForSlot(int slot) const { return static_cast<int>(m_emails.size()) - 1 - slot; }
+    int slotForRow(int row) const { return static_cast<int>(m_emails.size()) - 1 - row; }
+    void rebuildIndex();
+    static QString key(const QString &account, const QString &id) { return account + QChar(0x1F) + id; }
+    static QString key(const Email &email) { return key(email.account, email.id); }
+
+    QList<Email> m_emails;
+    QHash<QString, int> m_index;
+};
+
+#endif // MAILBOXMODEL_H
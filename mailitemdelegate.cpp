@@ -0,0 +1,103 @@
+#include "mailitemdelegate.h"
+#include "mailboxmodel.h"
+#include "outbox.h"
+#include <QPainter>
+#include <QApplication>
+#include <QDateTime>
+
+namespace {
+const int kPadding = 10;
+const int kLineSpacing = 4;
+const int kDotSize = 8;
+}
+
+MailItemDelegate::MailItemDelegate(QObject *parent)
+    : QStyledItemDelegate(parent)
+{
+}
+
+void MailItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    QStyleOptionViewItem opt = option;
+    initStyleOption(&opt, index);
+    opt.text.clear();
+
+    // 背景和选中状态交给样式绘制
+    const QWidget *widget = opt.widget;
+    QStyle *style = widget ? widget->style() : QApplication::style();
+    style->drawPrimitive(QStyle::PE_PanelItemViewItem, &opt, painter, widget);
+
+    const bool selected = opt.state & QStyle::State_Selected;
+    const bool unread = !index.data(MailboxModel::ReadRole).toBool();
+    const QString sender = index.data(MailboxModel::SenderRole).toString();
+    const QString subject = index.data(MailboxModel::SubjectRole).toString();
+    const int sendState = index.data(MailboxModel::SendStateRole).toInt();
+    // 发件箱中的邮件用发送状态代替时间
+    QString time;
+    switch (sendState) {
+    case Outbox::Queued:
+        time = "等待发送";
+        break;
+    case Outbox::Sending:
+        time = "发送中…";
+        break;
+    case Outbox::Retrying:
+        time = "等待重试";
+        break;
+    case Outbox::Failed:
+        time = "发送失败";
+        break;
+    default:
+        time = index.data(MailboxModel::TimeRole).toDateTime().toString("MM-dd hh:mm");
+        break;
+    }
+
+    painter->save();
+
+    const QRect rect = opt.rect.adjusted(kPadding + kDotSize + kPadding / 2, kPadding, -kPadding, -kPadding);
+    const QColor textColor = opt.palette.color(selected ? QPalette::HighlightedText : QPalette::Text);
+    const QColor secondaryColor = selected ? textColor : QColor("#888888");
+
+    QFont senderFont = opt.font;
+    senderFont.setBold(unread);
+    const QFontMetrics senderMetrics(senderFont);
+    const QFontMetrics metrics(opt.font);
+    const int lineHeight = metrics.height();
+
+    // 未读圆点
+    if (unread) {
+        painter->setRenderHint(QPainter::Antialiasing);
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(selected ? textColor : QColor("#0078d4"));
+        painter->drawEllipse(opt.rect.left() + kPadding, rect.top() + (lineHeight - kDotSize) / 2, kDotSize, kDotSize);
+    }
+
+    // 第一行：发件人 + 右侧时间
+    const int timeWidth = metrics.horizontalAdvance(time);
+    QRect firstLine(rect.left(), rect.top(), rect.width(), lineHeight);
+    painter->setFont(opt.font);
+    painter->setPen(sendState == Outbox::Failed && !selected ? QColor("#d13438") : secondaryColor);
+    painter->drawText(firstLine, Qt::AlignRight | Qt::AlignVCenter, time);
+
+    firstLine.setRight(firstLine.right() - timeWidth - kPadding);
+    painter->setFont(senderFont);
+    painter->setPen(textColor);
+    painter->drawText(firstLine, Qt::AlignLeft | Qt::AlignVCenter,
+                      senderMetrics.elidedText(sender, Qt::ElideRight, firstLine.width()));
+
+    // 第二行：主题
+    const QRect secondLine(rect.left(), rect.top() + lineHeight + kLineSpacing, rect.width(), lineHeight);
+    painter->setFont(opt.font);
+    painter->setPen(textColor);
+    painter->drawText(secondLine, Qt::AlignLeft | Qt::AlignVCenter,
+                      metrics.elidedText(subject, Qt::ElideRight, secondLine.width()));
+
+    painter->restore();
+}
+
+QSize MailItemDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    Q_UNUSED(index);
+    const QFontMetrics metrics(option.font);
+    return QSize(option.rect.width(), metrics.height() * 2 + kLineSpacing + kPadding * 2);
+}
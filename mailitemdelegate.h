@@ -0,0 +1,21 @@
+#ifndef MAILITEMDELEGATE_H
+#define MAILITEMDELEGATE_H
+
+#include <QStyledItemDelegate>
+
+/*
+ * 邮件列表项绘制：第一行发件人和时间，第二行主题，未读邮件显示圆点并加粗。
+ * 所有行高度相同，配合 QListView::setUniformItemSizes 使用。
+ */
+class MailItemDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    explicit MailItemDelegate(QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+};
+
+#endif // MAILITEMDELEGATE_H
@@ -0,0 +1,592 @@
+#include "mailstore.h"
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QDataStream>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QMutexLocker>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+const quint32 kIndexMagic = 0x58494D59;   // "YMIX"
+const quint32 kIndexVersion = 1;
+const quint32 kLogMagic = 0x474C4D59;     // "YMLG"
+const quint32 kMinIndexCapacity = 256;     // 索引文件按容量倍增，避免每封邮件重新映射
+
+const int kSearchSaveInterval = 500;      // 每索引这么多封邮件落盘一次
+const int kMaxIndexedBody = 64 * 1024;    // 正文只索引前 64K 字符
+
+enum RecordType : quint32 {
+    EnvelopeRecord = 1,
+    BodyRecord = 2,
+    RawRecord = 3
+};
+
+#pragma pack(push, 1)
+struct IndexHeader {
+    quint32 magic;
+    quint32 version;
+    quint32 uidValidity;
+    quint32 uidNext;
+    quint32 count;
+    quint32 lastUid;
+    quint32 reserved[2];
+};
+
+struct IndexRecord {
+    quint32 uid;
+    quint32 flags;
+    qint64 time;              // 毫秒时间戳
+    quint64 envelopeOffset;
+    quint32 envelopeLength;
+    quint32 bodyLength;
+    quint64 bodyOffset;
+    quint64 rawOffset;
+    quint32 rawLength;
+    quint32 reserved[3];
+};
+
+struct LogRecordHeader {
+    quint32 magic;
+    quint32 type;
+    quint32 length;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(IndexHeader) == 32, "索引头必须是 32 字节");
+static_assert(sizeof(IndexRecord) == 64, "索引记录必须是 64 字节");
+
+QByteArray encodeEnvelope(const Email &email)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << email.sender << email.subject << email.attachments;
+    return payload;
+}
+
+QByteArray encodeBody(const Email &email)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << email.content << email.isHtml << email.attachments;
+    return payload;
+}
+
+QString envelopeText(const Email &email)
+{
+    return email.sender + QLatin1Char(' ') + email.subject + QLatin1Char(' ') + email.attachments.join(QLatin1Char(' '));
+}
+
+QString bodyText(const Email &email)
+{
+    QString text = email.isHtml ? SearchIndex::stripHtml(email.content) : email.content;
+    text.truncate(kMaxIndexedBody);
+    return text;
+}
+
+} // namespace
+
+struct MailStore::Folder {
+    QString name;
+    QFile index;
+    QFile log;
+    uchar *map = nullptr;
+    QHash<quint32, int> positions;   // UID -> 索引记录序号
+
+    IndexHeader *header() { return reinterpret_cast<IndexHeader *>(map); }
+    IndexRecord *record(int i) { return reinterpret_cast<IndexRecord *>(map + sizeof(IndexHeader)) + i; }
+    // 索引文件中可容纳的记录数，超出 header()->count 的部分是预留的空记录
+    quint32 capacity() const
+    {
+        return static_cast<quint32>((index.size() - static_cast<qint64>(sizeof(IndexHeader))) / sizeof(IndexRecord));
+    }
+    IndexRecord *find(unsigned long uid)
+    {
+        auto it = positions.constFind(static_cast<quint32>(uid));
+        return it == positions.constEnd() ? nullptr : record(it.value());
+    }
+};
+
+MailStore::MailStore() = default;
+
+MailStore::~MailStore()
+{
+    close();
+}
+
+bool MailStore::open(const QString &accountEmail)
+{
+    close();
+
+    QMutexLocker locker(&m_mutex);
+    QByteArray key = QCryptographicHash::hash(accountEmail.trimmed().toLower().toUtf8(),
+                                              QCryptographicHash::Sha1).toHex().left(16);
+    m_root = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+             + "/store/" + QString::fromLatin1(key);
+    if (!QDir().mkpath(m_root)) {
+        qWarning() << "无法创建本地邮件存储目录:" << m_root;
+        m_root.clear();
+        return false;
+    }
+
+    m_accountEmail = accountEmail;
+    qDebug() << "打开本地邮件存储:" << m_root;
+
+    if (!m_search.load(m_root + "/search.idx")) {
+        rebuildSearchIndex();
+    }
+    return true;
+}
+
+void MailStore::close()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_searchDirty > 0) {
+        saveSearchIndex();
+    }
+    m_search.clear();
+    for (auto &entry : m_folders) {
+        Folder *folder = entry.second.get();
+        if (folder->map) {
+            folder->index.unmap(folder->map);
+            folder->map = nullptr;
+        }
+    }
+    m_folders.clear();
+    m_accountEmail.clear();
+    m_root.clear();
+}
+
+bool MailStore::isOpen() const
+{
+    QMutexLocker locker(&m_mutex);
+    return !m_root.isEmpty();
+}
+
+QString MailStore::accountEmail() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_accountEmail;
+}
+
+QString MailStore::rootPath() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_root;
+}
+
+QStringList MailStore::search(const QString &query, int limit)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_search.search(query, limit);
+}
+
+void MailStore::indexEmail(const Email &email, bool withBody)
+{
+    m_search.addText(email.id, withBody ? envelopeText(email) + QLatin1Char(' ') + bodyText(email) : envelopeText(email));
+    if (++m_searchDirty >= kSearchSaveInterval) {
+        saveSearchIndex();
+    }
+}
+
+void MailStore::saveSearchIndex()
+{
+    if (m_root.isEmpty()) {
+        return;
+    }
+    if (!m_search.save(m_root + "/search.idx")) {
+        qWarning() << "保存搜索索引失败:" << m_root;
+        return;
+    }
+    m_searchDirty = 0;
+}
+
+void MailStore::rebuildSearchIndex()
+{
+    // 没有索引文件（首次使用或索引损坏）时从日志重建
+    m_search.clear();
+    const QStringList dirs = QDir(m_root).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &dir : dirs) {
+        const QString name = QString::fromUtf8(QByteArray::fromHex(dir.toLatin1()));
+        Folder *folder = openFolder(name);
+        if (!folder) {
+            continue;
+        }
+
+        const quint32 uidValidity = folder->header()->uidValidity;
+        for (quint32 i = 0; i < folder->header()->count; ++i) {
+            const IndexRecord *rec = folder->record(i);
+            Email email;
+            email.id = emailId(name, uidValidity, rec->uid);
+            email.isHtml = rec->flags & Html;
+
+            QDataStream envelope(readRecord(folder, rec->envelopeOffset, rec->envelopeLength));
+            envelope.setVersion(QDataStream::Qt_5_15);
+            envelope >> email.sender >> email.subject >> email.attachments;
+
+            QString text = envelopeText(email);
+            if (rec->bodyLength > 0) {
+                QDataStream body(readRecord(folder, rec->bodyOffset, rec->bodyLength));
+                body.setVersion(QDataStream::Qt_5_15);
+                body >> email.content >> email.isHtml >> email.attachments;
+                text += QLatin1Char(' ') + bodyText(email);
+            }
+            m_search.addText(email.id, text);
+        }
+    }
+
+    qDebug() << "搜索索引重建完成，邮件数:" << m_search.documentCount();
+    saveSearchIndex();
+}
+
+QString MailStore::emailId(const QString &folder, unsigned long uidValidity, unsigned long uid)
+{
+    return QString("%1/%2/%3").arg(folder).arg(uidValidity).arg(uid);
+}
+
+MailStore::Folder *MailStore::openFolder(const QString &name)
+{
+    if (m_root.isEmpty() || name.isEmpty()) {
+        return nullptr;
+    }
+
+    auto it = m_folders.find(name);
+    if (it != m_folders.end()) {
+        return it->second.get();
+    }
+
+    QString dir = m_root + "/" + QString::fromLatin1(name.toUtf8().toHex());
+    if (!QDir().mkpath(dir)) {
+        return nullptr;
+    }
+
+    auto folder = std::make_unique<Folder>();
+    folder->name = name;
+    folder->index.setFileName(dir + "/index.dat");
+    folder->log.setFileName(dir + "/messages.log");
+    if (!folder->index.open(QIODevice::ReadWrite) || !folder->log.open(QIODevice::ReadWrite)) {
+        qWarning() << "无法打开本地邮件存储文件:" << dir;
+        return nullptr;
+    }
+
+    // 新文件或格式不符时重建索引
+    IndexHeader header{};
+    bool valid = folder->index.size() >= static_cast<qint64>(sizeof(IndexHeader))
+                 && folder->index.read(reinterpret_cast<char *>(&header), sizeof(header)) == sizeof(header)
+                 && header.magic == kIndexMagic && header.version == kIndexVersion;
+    if (!valid) {
+        header = IndexHeader{};
+        header.magic = kIndexMagic;
+        header.version = kIndexVersion;
+        folder->index.resize(0);
+        folder->index.seek(0);
+        folder->index.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        folder->log.resize(0);
+    }
+
+    if (!remapIndex(folder.get())) {
+        return nullptr;
+    }
+
+    // 丢弃崩溃时写了一半的记录
+    quint32 count = std::min(folder->header()->count, folder->capacity());
+    const quint64 logSize = static_cast<quint64>(folder->log.size());
+    for (quint32 i = 0; i < count; ++i) {
+        const IndexRecord *rec = folder->record(i);
+        if (rec->envelopeOffset + rec->envelopeLength > logSize
+            || rec->bodyOffset + rec->bodyLength > logSize
+            || rec->rawOffset + rec->rawLength > logSize) {
+            count = i;
+            break;
+        }
+        folder->positions.insert(rec->uid, static_cast<int>(i));
+    }
+    folder->header()->count = count;
+
+    Folder *result = folder.get();
+    m_folders.emplace(name, std::move(folder));
+    return result;
+}
+
+bool MailStore::remapIndex(Folder *folder)
+{
+    if (folder->map) {
+        folder->index.unmap(folder->map);
+        folder->map = nullptr;
+    }
+    folder->map = folder->index.map(0, folder->index.size());
+    if (!folder->map) {
+        qWarning() << "无法映射索引文件:" << folder->index.fileName();
+        return false;
+    }
+    return true;
+}
+
+bool MailStore::growIndex(Folder *folder, quint32 required)
+{
+    quint32 capacity = std::max(kMinIndexCapacity, folder->capacity());
+    while (capacity < required) {
+        capacity *= 2;
+    }
+
+    // 扩展的部分由文件系统补零；失败时保留原来的映射
+    folder->index.unmap(folder->map);
+    folder->map = nullptr;
+    if (!folder->index.resize(static_cast<qint64>(sizeof(IndexHeader)) + static_cast<qint64>(capacity) * sizeof(IndexRecord))) {
+        qWarning() << "扩展邮件索引失败:" << folder->index.errorString();
+        remapIndex(folder);
+        return false;
+    }
+    return remapIndex(folder);
+}
+
+bool MailStore::appendRecord(Folder *folder, quint32 type, const QByteArray &payload, quint64 &offset)
+{
+    LogRecordHeader header{kLogMagic, type, static_cast<quint32>(payload.size())};
+    const qint64 start = folder->log.size();
+    if (!folder->log.seek(start)
+        || folder->log.write(reinterpret_cast<const char *>(&header), sizeof(header)) != sizeof(header)
+        || folder->log.write(payload) != payload.size()) {
+        qWarning() << "写入邮件日志失败:" << folder->log.errorString();
+        return false;
+    }
+    folder->log.flush();
+    offset = static_cast<quint64>(start) + sizeof(header);
+    return true;
+}
+
+QByteArray MailStore::readRecord(Folder *folder, quint64 offset, quint32 length)
+{
+    if (length == 0 || !folder->log.seek(static_cast<qint64>(offset))) {
+        return QByteArray();
+    }
+    return folder->log.read(length);
+}
+
+QList<Email> MailStore::loadEmails(const QString &folderName)
+{
+    QMutexLocker locker(&m_mutex);
+    QList<Email> emails;
+
+    Folder *folder = openFolder(folderName);
+    if (!folder) {
+        return emails;
+    }
+
+    const quint32 count = folder->header()->count;
+    const quint32 uidValidity = folder->header()->uidValidity;
+    emails.reserve(static_cast<int>(count));
+
+    // 一次映射日志文件，避免逐条 seek/read
+    const qint64 logSize = folder->log.size();
+    uchar *logMap = logSize > 0 ? folder->log.map(0, logSize) : nullptr;
+
+    for (quint32 i = 0; i < count; ++i) {
+        const IndexRecord *rec = folder->record(i);
+
+        Email email;
+        email.id = emailId(folderName, uidValidity, rec->uid);
+        email.folder = folderName;
+        email.account = m_accountEmail;
+        email.uid = rec->uid;
+        email.time = QDateTime::fromMSecsSinceEpoch(rec->time);
+        email.isRead = rec->flags & Read;
+        email.isFavorite = rec->flags & Favorite;
+        email.isTrashed = rec->flags & Trashed;
+        email.isHtml = rec->flags & Html;
+        email.bodyLoaded = false;
+
+        QByteArray envelope = logMap
+            ? QByteArray::fromRawData(reinterpret_cast<const char *>(logMap + rec->envelopeOffset), rec->envelopeLength)
+            : readRecord(folder, rec->envelopeOffset, rec->envelopeLength);
+        QDataStream in(envelope);
+        in.setVersion(QDataStream::Qt_5_15);
+        in >> email.sender >> email.subject >> email.attachments;
+
+        emails.append(email);
+    }
+
+    if (logMap) {
+        folder->log.unmap(logMap);
+    }
+
+    // 最新的邮件在前
+    std::reverse(emails.begin(), emails.end());
+    return emails;
+}
+
+MailStore::FolderState MailStore::folderState(const QString &folderName)
+{
+    QMutexLocker locker(&m_mutex);
+    FolderState state;
+    Folder *folder = openFolder(folderName);
+    if (folder) {
+        state.uidValidity = folder->header()->uidValidity;
+        state.uidNext = folder->header()->uidNext;
+        state.lastUid = folder->header()->lastUid;
+    }
+    return state;
+}
+
+void MailStore::resetFolder(const QString &folderName, unsigned long uidValidity)
+{
+    QMutexLocker locker(&m_mutex);
+    Folder *folder = openFolder(folderName);
+    if (!folder || folder->header()->uidValidity == uidValidity) {
+        return;
+    }
+
+    qDebug() << "清空本地文件夹:" << folderName << "UIDVALIDITY:" << uidValidity;
+    m_search.removeByPrefix(QString("%1/%2/").arg(folderName).arg(folder->header()->uidValidity));
+    ++m_searchDirty;
+    folder->index.unmap(folder->map);
+    folder->map = nullptr;
+    folder->index.resize(sizeof(IndexHeader));
+    folder->log.resize(0);
+    folder->positions.clear();
+    if (!remapIndex(folder)) {
+        return;
+    }
+
+    IndexHeader *header = folder->header();
+    header->uidValidity = static_cast<quint32>(uidValidity);
+    header->uidNext = 0;
+    header->count = 0;
+    header->lastUid = 0;
+}
+
+void MailStore::setUidNext(const QString &folderName, unsigned long uidNext)
+{
+    QMutexLocker locker(&m_mutex);
+    Folder *folder = openFolder(folderName);
+    if (folder) {
+        folder->header()->uidNext = static_cast<quint32>(uidNext);
+    }
+}
+
+bool MailStore::appendEmail(const Email &email)
+{
+    QMutexLocker locker(&m_mutex);
+    Folder *folder = openFolder(email.folder);
+    if (!folder || email.uid == 0) {
+        return false;
+    }
+    if (folder->positions.contains(static_cast<quint32>(email.uid))) {
+        return true;
+    }
+
+    IndexRecord rec{};
+    rec.uid = static_cast<quint32>(email.uid);
+    rec.time = email.time.toMSecsSinceEpoch();
+    rec.flags = (email.isRead ? Read : 0) | (email.isFavorite ? Favorite : 0)
+                | (email.isTrashed ? Trashed : 0) | (email.isHtml ? Html : 0);
+
+    QByteArray envelope = encodeEnvelope(email);
+    if (!appendRecord(folder, EnvelopeRecord, envelope, rec.envelopeOffset)) {
+        return false;
+    }
+    rec.envelopeLength = static_cast<quint32>(envelope.size());
+
+    if (email.bodyLoaded) {
+        QByteArray body = encodeBody(email);
+        if (!appendRecord(folder, BodyRecord, body, rec.bodyOffset)) {
+            return false;
+        }
+        rec.bodyLength = static_cast<quint32>(body.size());
+    }
+
+    // 先写日志再写索引，索引记录数是提交点。记录直接写入映射，
+    // 只有容量用完时才扩展文件并重新映射
+    const quint32 count = folder->header()->count;
+    if (count >= folder->capacity() && !growIndex(folder, count + 1)) {
+        return false;
+    }
+    *folder->record(static_cast<int>(count)) = rec;
+
+    IndexHeader *header = folder->header();
+    header->count = count + 1;
+    header->lastUid = std::max(header->lastUid, rec.uid);
+    folder->positions.insert(rec.uid, static_cast<int>(count));
+    indexEmail(email, email.bodyLoaded);
+    return true;
+}
+
+bool MailStore::appendLocalEmail(Email &email)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        Folder *folder = openFolder(email.folder);
+        if (!folder) {
+            return false;
+        }
+        email.uid = folder->header()->lastUid + 1;
+        email.id = emailId(email.folder, folder->header()->uidValidity, email.uid);
+        email.account = m_accountEmail;
+    }
+    return appendEmail(email);
+}
+
+bool MailStore::storeBody(const Email &email, const QByteArray &raw)
+{
+    QMutexLocker locker(&m_mutex);
+    Folder *folder = openFolder(email.folder);
+    IndexRecord *rec = folder ? folder->find(email.uid) : nullptr;
+    if (!rec) {
+        return false;
+    }
+
+    quint64 bodyOffset = 0;
+    QByteArray body = encodeBody(email);
+    if (!appendRecord(folder, BodyRecord, body, bodyOffset)) {
+        return false;
+    }
+
+    quint64 rawOffset = 0;
+    if (!raw.isEmpty() && !appendRecord(folder, RawRecord, raw, rawOffset)) {
+        return false;
+    }
+
+    // 日志写完后 find() 得到的指针仍然有效，索引映射没有变化
+    rec->bodyOffset = bodyOffset;
+    rec->bodyLength = static_cast<quint32>(body.size());
+    if (!raw.isEmpty()) {
+        rec->rawOffset = rawOffset;
+        rec->rawLength = static_cast<quint32>(raw.size());
+    }
+    rec->flags = email.isHtml ? (rec->flags | Html) : (rec->flags & ~Html);
+    indexEmail(email, true);
+    return true;
+}
+
+bool MailStore::loadBody(Email &email)
+{
+    QMutexLocker locker(&m_mutex);
+    Folder *folder = openFolder(email.folder);
+    IndexRecord *rec = folder ? folder->find(email.uid) : nullptr;
+    if (!rec || rec->bodyLength == 0) {
+        return false;
+    }
+
+    QByteArray body = readRecord(folder, rec->bodyOffset, rec->bodyLength);
+    QDataStream in(body);
+    in.setVersion(QDataStream::Qt_5_15);
+    in >> email.content >> email.isHtml >> email.attachments;
+    email.bodyLoaded = in.status() == QDataStream::Ok;
+    return email.bodyLoaded;
+}
+
+void MailStore::setFlag(const Email &email, Flag flag, bool on)
+{
+    QMutexLocker locker(&m_mutex);
+    Folder *folder = openFolder(email.folder);
+    IndexRecord *rec = folder ? folder->find(email.uid) : nullptr;
+    if (rec) {
+        // 直接修改映射内存，由操作系统回写
+        rec->flags = on ? (rec->flags | flag) : (rec->flags & ~static_cast<quint32>(flag));
+    }
+}
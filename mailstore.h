@@ -0,0 +1,96 @@
+#ifndef MAILSTORE_H
+#define MAILSTORE_H
+
+#include <QString>
+#include <QList>
+#include <QByteArray>
+#include <QMutex>
+#include <map>
+#include <memory>
+#include "accountdialog.h"  // 包含 Email 定义
+#include "searchindex.h"
+
+/*
+ * 本地邮件存储
+ *
+ * 每个账户每个文件夹一个目录，包含两个文件：
+ *   messages.log  追加写日志，保存邮件头摘要、正文和原始 RFC 822 数据
+ *   index.dat     定长索引，按 UID 记录标记位和日志偏移，启动时直接内存映射
+ *
+ * 邮件以 (账户, 文件夹, UIDVALIDITY, UID) 为键，UIDVALIDITY 变化时整个文件夹清空。
+ * 写入的邮件头和正文同时加入账户目录下的全文索引 search.idx。
+ * 所有方法都是线程安全的。
+ */
+class MailStore
+{
+public:
+    enum Flag : quint32 {
+        Read = 0x01,
+        Favorite = 0x02,
+        Trashed = 0x04,
+        Html = 0x08
+    };
+
+    struct FolderState {
+        unsigned long uidValidity = 0;
+        unsigned long uidNext = 0;
+        unsigned long lastUid = 0;
+    };
+
+    MailStore();
+    ~MailStore();
+
+    MailStore(const MailStore&) = delete;
+    MailStore& operator=(const MailStore&) = delete;
+
+    bool open(const QString &accountEmail);
+    void close();
+    bool isOpen() const;
+    QString accountEmail() const;
+    // 账户存储目录，发件箱等其他按账户保存的数据也放在这里
+    QString rootPath() const;
+
+    // 读取文件夹中全部邮件的摘要（不含正文）
+    QList<Email> loadEmails(const QString &folder);
+
+    FolderState folderState(const QString &folder);
+    // UIDVALIDITY 与本地不一致时清空文件夹
+    void resetFolder(const QString &folder, unsigned long uidValidity);
+    void setUidNext(const QString &folder, unsigned long uidNext);
+
+    // 保存服务器邮件摘要，email.folder 和 email.uid 必须有效
+    bool appendEmail(const Email &email);
+    // 保存本地邮件（如已发送），分配本地 UID
+    bool appendLocalEmail(Email &email);
+
+    bool storeBody(const Email &email, const QByteArray &raw);
+    bool loadBody(Email &email);
+    void setFlag(const Email &email, Flag flag, bool on);
+
+    // 本地全文搜索，返回邮件 id，较新的在前
+    QStringList search(const QString &query, int limit = 500);
+
+    static QString emailId(const QString &folder, unsigned long uidValidity, unsigned long uid);
+
+private:
+    struct Folder;
+
+    Folder *openFolder(const QString &name);
+    bool appendRecord(Folder *folder, quint32 type, const QByteArray &payload, quint64 &offset);
+    QByteArray readRecord(Folder *folder, quint64 offset, quint32 length);
+    bool remapIndex(Folder *folder);
+    // 把索引文件扩展到至少能容纳 required 条记录，容量按倍数增长
+    bool growIndex(Folder *folder, quint32 required);
+    void indexEmail(const Email &email, bool withBody);
+    void rebuildSearchIndex();
+    void saveSearchIndex();
+
+    mutable QMutex m_mutex;
+    QString m_accountEmail;
+    QString m_root;
+    std::map<QString, std::unique_ptr<Folder>> m_folders;
+    SearchIndex m_search;
+    int m_searchDirty = 0;
+};
+
+#endif // MAILSTORE_H
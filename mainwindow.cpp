@@ -2,9 +2,10 @@
 #include "ui_mainwindow.h"
 #include "settingdialog.h"
 #include "composedialog.h"
-#include <QtConcurrent/QtConcurrent>
+#include "mailitemdelegate.h"
 #include <QPushButton>
-#include <QListWidgetItem>
+#include <QItemSelectionModel>
+#include <QLineEdit>
 #include <QFile>
 #include <QTextStream>
 #include <QCloseEvent>
@@ -20,6 +21,10 @@
 #include <QMessageBox>
 #include <QRandomGenerator>
 #include <QProgressDialog>
+#include <QFileDialog>
+#include <QStandardPaths>
+#include <QDir>
+#include <QTextBrowser>
 #include <QMetaObject>
 #include <QThread>
 #include <functional>
@@ -30,13 +35,12 @@ MainWindow::MainWindow(QWidget *parent)
     , ui(new Ui::MainWindow)
     , settingDialog(nullptr)
     , accountDialog(nullptr)
-    , emailClient(nullptr)
     , trayIcon(nullptr)
+    , networkBudget(nullptr)
     , checkTimer(nullptr)
-    , uiUpdateTimer(nullptr)
     , threadPool(nullptr)
-    , connectionWatcher(nullptr)
-    , operationWatcher(nullptr)
+    , unifiedModel(nullptr)
+    , searchModel(nullptr)
     , currentView(Inbox)
 {
     // 首先设置窗口属性
@@ -52,6 +56,7 @@ MainWindow::MainWindow(QWidget *parent)
     // 设置 UI 和连接
     setupUI();
     loadTheme();
+    syncAccounts();
     updateEmailList();
     setupConnections();
 
@@ -67,24 +72,17 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
-    // 清理线程相关资源
-    if (connectionWatcher) {
-        connectionWatcher->cancel();
-        connectionWatcher->waitForFinished();
-        delete connectionWatcher;
-    }
-
-    if (operationWatcher) {
-        operationWatcher->cancel();
-        operationWatcher->waitForFinished();
-        delete operationWatcher;
+    for (auto &entry : accounts) {
+        closeAccount(entry.second.get());
     }
+    accounts.clear();
 
     if (threadPool) {
         threadPool->clear();
         threadPool->waitForDone();
     }
 
+    delete networkBudget;
     delete ui;
 }
 
@@ -92,14 +90,14 @@ void MainWindow::initializeComponents()
 {
     settingDialog = new SettingDialog(this);
     accountDialog = new AccountDialog(this);
-    emailClient = new EmailClient(this);
     trayIcon = new TrayIcon(this);
+    networkBudget = new QSemaphore(kNetworkConcurrency);
+
+    unifiedModel = new MailboxModel(this);
+    searchModel = new MailboxModel(this);
 
     checkTimer = new QTimer(this);
-    uiUpdateTimer = new QTimer(this);
     threadPool = new QThreadPool(this);
-    connectionWatcher = new QFutureWatcher<void>(this);
-    operationWatcher = new QFutureWatcher<void>(this);
 
     // 配置线程池
     threadPool->setMaxThreadCount(QThread::idealThreadCount());
@@ -109,15 +107,18 @@ void MainWindow::setupConnections()
 {
     // UI 按钮连接
     connect(ui->inboxButton, &QPushButton::clicked, this, &MainWindow::onInboxClicked);
+    connect(ui->unifiedInboxButton, &QPushButton::clicked, this, &MainWindow::onUnifiedInboxClicked);
     connect(ui->sendButton, &QPushButton::clicked, this, &MainWindow::onSendClicked);
     connect(ui->favoriteButton, &QPushButton::clicked, this, &MainWindow::onFavoriteClicked);
     connect(ui->trashButton, &QPushButton::clicked, this, &MainWindow::onTrashClicked);
     connect(ui->accountButton, &QPushButton::clicked, this, &MainWindow::onAccountClicked);
     connect(ui->settingButton, &QPushButton::clicked, this, &MainWindow::onSettingClicked);
-    connect(ui->emailList, &QListWidget::itemClicked, this, &MainWindow::onEmailItemClicked);
+    connect(ui->emailList, &QListView::clicked, this, &MainWindow::onEmailItemClicked);
     connect(ui->composeButton, &QPushButton::clicked, this, &MainWindow::onComposeClicked);
     connect(ui->replyButton, &QPushButton::clicked, this, &MainWindow::onReplyClicked);
     connect(ui->favoriteContentButton, &QPushButton::clicked, this, &MainWindow::onFavoriteContentClicked);
+    connect(ui->searchEdit, &QLineEdit::textChanged, this, &MainWindow::onSearchTextChanged);
+    connect(ui->emailContent, &QTextBrowser::anchorClicked, this, &MainWindow::onEmailContentLinkClicked);
 
     // 标题栏按钮
     connect(ui->minimizeButton, &QPushButton::clicked, this, &MainWindow::onMinimizeClicked);
@@ -127,31 +128,17 @@ void MainWindow::setupConnections()
     // 设置和账户变化
     connect(settingDialog, &SettingDialog::themeChanged, this, &MainWindow::loadTheme);
     connect(accountDialog, &AccountDialog::accountChanged, this, &MainWindow::onAccountChanged);
+    connect(accountDialog, &AccountDialog::accountsChanged, this, &MainWindow::onAccountsChanged);
 
     // 系统托盘
     connect(trayIcon, &TrayIcon::activated, this, &MainWindow::trayIconActivated);
     connect(trayIcon, &TrayIcon::restoreRequested, this, &MainWindow::restoreFromTray);
 
-    // 邮件客户端信号
-    connect(emailClient, &EmailClient::newEmailReceived, this, &MainWindow::onEmailReceived);
-    connect(emailClient, &EmailClient::connectionStatusChanged, this, &MainWindow::onConnectionStatusChanged);
-    connect(emailClient, &EmailClient::emailSent, this, &MainWindow::onEmailSent);
-    connect(emailClient, &EmailClient::errorOccurred, this, &MainWindow::onEmailError);
-
-    // 线程完成信号
-    connect(connectionWatcher, &QFutureWatcher<void>::finished, this, &MainWindow::onEmailConnectionFinished);
-    connect(operationWatcher, &QFutureWatcher<void>::finished, this, &MainWindow::onEmailOperationFinished);
+    // 邮件客户端的信号在 openAccount 中按账户连接
 
     // 定时器
-    checkTimer->setInterval(60000); // 60秒检查一次新邮件
+    checkTimer->setInterval(60000); // 60秒检查一次新邮件，IDLE 可用的账户放宽到 15 分钟
     connect(checkTimer, &QTimer::timeout, this, &MainWindow::checkNewEmails);
-
-    uiUpdateTimer->setInterval(100); // 100ms UI 更新间隔
-    connect(uiUpdateTimer, &QTimer::timeout, this, [this]() {
-        if (!isOperating.load()) {
-            uiUpdateTimer->stop();
-        }
-    });
 }
 
 void MainWindow::setupThreading()
@@ -168,156 +155,409 @@ void MainWindow::startInitialTasks()
     QTimer::singleShot(1000, this, &MainWindow::connectToEmailServerAsync);
 }
 
-void MainWindow::connectToEmailServerAsync()
+void MainWindow::syncAccounts()
 {
-    if (isConnecting.exchange(true)) {
-        return; // 已经在连接中
-    }
+    const QList<EmailAccount> configured = accountDialog ? accountDialog->getAccounts() : QList<EmailAccount>();
+    bool changedSet = false;
 
-    if (!accountDialog) {
-        isConnecting.store(false);
-        qDebug() << "账户对话框未初始化";
-        return;
+    // 已删除或配置变化的账户关闭后重新打开
+    for (auto it = accounts.begin(); it != accounts.end();) {
+        const auto match = std::find_if(configured.begin(), configured.end(), [&it](const EmailAccount &account) {
+            return account.email == it->first;
+        });
+        const AccountContext *context = it->second.get();
+        const bool changed = match != configured.end()
+            && (match->password != context->account.password || match->protocol != context->account.protocol
+                || match->imapServer != context->account.imapServer || match->imapPort != context->account.imapPort
+                || match->imapEncryption != context->account.imapEncryption
+                || match->smtpServer != context->account.smtpServer || match->smtpPort != context->account.smtpPort
+                || match->smtpEncryption != context->account.smtpEncryption);
+        if (match == configured.end() || changed) {
+            closeAccount(it->second.get());
+            it = accounts.erase(it);
+            changedSet = true;
+        } else {
+            ++it;
+        }
     }
 
-    EmailAccount currentAccount = accountDialog->getCurrentAccount();
-    if (currentAccount.email.isEmpty()) {
-        isConnecting.store(false);
-        qDebug() << "没有配置邮件账户，跳过连接";
-        return;
+    for (const EmailAccount &account : configured) {
+        if (!account.email.isEmpty() && accounts.find(account.email) == accounts.end()) {
+            if (AccountContext *context = openAccount(account)) {
+                loadLocalEmails(context);
+                changedSet = true;
+            }
+        }
     }
 
-    qDebug() << "开始异步连接邮件服务器...";
+    currentAccount = accountDialog ? accountDialog->getCurrentAccountEmail() : QString();
+    if (!accountContext(currentAccount) && !accounts.empty()) {
+        currentAccount = accounts.begin()->first;
+    }
+    if (changedSet) {
+        rebuildUnifiedInbox();
+    }
+}
 
-    if (!emailClient) {
-        isConnecting.store(false);
-        qDebug() << "邮件客户端未初始化";
-        return;
+MainWindow::AccountContext *MainWindow::openAccount(const EmailAccount &account)
+{
+    auto context = std::make_unique<AccountContext>();
+    context->account = account;
+    context->store = new MailStore();
+    if (!context->store->open(account.email)) {
+        delete context->store;
+        return nullptr;
     }
+    context->outbox = new Outbox();
+    context->outbox->open(context->store->rootPath() + "/outbox");
+
+    context->inbox = new MailboxModel(this);
+    context->sent = new MailboxModel(this);
+    context->favorite = new MailboxModel(this);
+    context->trash = new MailboxModel(this);
+
+    EmailClient *client = new EmailClient(this);
+    client->setMailStore(context->store);
+    client->setOutbox(context->outbox);
+    client->setNetworkBudget(networkBudget);
+    context->client = client;
+
+    // 信号来自各账户的工作线程，带上账户再转到 GUI 线程处理
+    const QString email = account.email;
+    connect(client, &EmailClient::newEmailReceived, this, &MainWindow::onEmailReceived);
+    connect(client, &EmailClient::emailBodyReceived, this, &MainWindow::onEmailBodyReceived);
+    connect(client, &EmailClient::attachmentProgress, this,
+            [this, email](const QString &emailId, int index, qint64 received, qint64 total) {
+        onAttachmentProgress(email, emailId, index, received, total);
+    });
+    connect(client, &EmailClient::attachmentSaved, this,
+            [this, email](const QString &emailId, int index, const QString &path, const QString &error) {
+        onAttachmentSaved(email, emailId, index, path, error);
+    });
+    connect(client, &EmailClient::mailboxReset, this, [this, email](const QString &folder) {
+        onMailboxReset(email, folder);
+    });
+    connect(client, &EmailClient::mailboxChanged, this, [this, email](const QString &folder) {
+        onMailboxChanged(email, folder);
+    });
+    connect(client, &EmailClient::idleStateChanged, this, [this, email](bool active) {
+        onIdleStateChanged(email, active);
+    });
+    connect(client, &EmailClient::connectionStatusChanged, this, [this, email](bool connected) {
+        onConnectionStatusChanged(email, connected);
+    });
+    connect(client, &EmailClient::outboxStateChanged, this,
+            [this, email](const QString &emailId, int state, const QString &error) {
+        onOutboxStateChanged(email, emailId, state, error);
+    });
+    connect(client, &EmailClient::errorOccurred, this, [this, email](const QString &error) {
+        onEmailError(email, error);
+    });
+
+    AccountContext *result = context.get();
+    accounts.emplace(account.email, std::move(context));
+    return result;
+}
 
-    QFuture<void> future = QtConcurrent::run([this, currentAccount]() {
-        emailClient->connectToServer(currentAccount);
+void MainWindow::closeAccount(AccountContext *context)
+{
+    if (currentEmailAccount == context->account.email) {
+        currentEmailId.clear();
+        currentEmailAccount.clear();
+    }
+    unifiedModel->removeIf([context](const Email &email) {
+        return email.account == context->account.email;
+    });
+    searchModel->removeIf([context](const Email &email) {
+        return email.account == context->account.email;
     });
 
-    if (connectionWatcher) {
-        connectionWatcher->setFuture(future);
+    // 先停止工作线程，它还在使用存储和发件箱。排队中的命令被丢弃，未发送的邮件留在发件箱中，
+    // 下次启动后继续；卡在读取上的连接会被关闭，不会阻塞界面
+    delete context->client;
+    context->client = nullptr;
+    delete context->outbox;
+    delete context->store;
+
+    if (ui && ui->emailList) {
+        for (MailboxModel *model : {context->inbox, context->sent, context->favorite, context->trash}) {
+            if (ui->emailList->model() == model) {
+                QItemSelectionModel *oldSelection = ui->emailList->selectionModel();
+                ui->emailList->setModel(nullptr);
+                delete oldSelection;
+            }
+        }
     }
+    delete context->inbox;
+    delete context->sent;
+    delete context->favorite;
+    delete context->trash;
 }
 
-void MainWindow::performEmailOperationAsync(const std::function<void()>& operation)
+MainWindow::AccountContext *MainWindow::accountContext(const QString &email) const
 {
-    if (isOperating.exchange(true)) {
-        return; // 已经在执行操作
-    }
+    auto it = accounts.find(email);
+    return it == accounts.end() ? nullptr : it->second.get();
+}
 
-    if (!operation) {
-        isOperating.store(false);
-        return;
+MainWindow::AccountContext *MainWindow::currentContext() const
+{
+    return accountContext(currentAccount);
+}
+
+void MainWindow::loadLocalEmails(AccountContext *context)
+{
+    // 从本地存储加载上次的邮件，无需等待网络
+    const QList<Email> inbox = context->store->loadEmails("INBOX");
+    QList<Email> sent = context->store->loadEmails("Sent");
+
+    // 还在发件箱中的邮件显示发送状态
+    QHash<QString, Outbox::Entry> pending;
+    for (const Outbox::Entry &entry : context->outbox->entries()) {
+        pending.insert(entry.emailId, entry);
+    }
+    for (Email &email : sent) {
+        auto it = pending.constFind(email.id);
+        if (it != pending.constEnd()) {
+            email.sendState = it->state;
+            email.sendError = it->lastError;
+        }
+    }
+    QList<Email> inboxEmails, sentEmails, favoriteEmails, trashEmails;
+    for (const Email &email : inbox) {
+        (email.isTrashed ? trashEmails : inboxEmails).append(email);
     }
+    for (const Email &email : sent) {
+        (email.isTrashed ? trashEmails : sentEmails).append(email);
+    }
+    for (const QList<Email> *list : {&inbox, &sent}) {
+        for (const Email &email : *list) {
+            if (email.isFavorite && !email.isTrashed) {
+                favoriteEmails.append(email);
+            }
+        }
+    }
+
+    context->inbox->setEmails(inboxEmails);
+    context->sent->setEmails(sentEmails);
+    context->favorite->setEmails(favoriteEmails);
+    context->trash->setEmails(trashEmails);
+
+    qDebug() << "本地邮件加载完成" << context->account.email
+             << "- 收件箱:" << inboxEmails.size() << "已发送:" << sentEmails.size();
+}
 
-    QFuture<void> future = QtConcurrent::run([this, operation]() {
-        operation();
+void MainWindow::rebuildUnifiedInbox()
+{
+    QList<Email> merged;
+    for (const auto &entry : accounts) {
+        MailboxModel *inbox = entry.second->inbox;
+        for (int row = 0; row < inbox->rowCount(); ++row) {
+            merged.append(*inbox->emailAt(row));
+        }
+    }
+    // 各账户的收件箱已按时间排列，合并后整体按时间从新到旧
+    std::stable_sort(merged.begin(), merged.end(), [](const Email &a, const Email &b) {
+        return a.time > b.time;
     });
+    unifiedModel->setEmails(merged);
+}
 
-    if (operationWatcher) {
-        operationWatcher->setFuture(future);
+void MainWindow::connectToEmailServerAsync()
+{
+    if (accounts.empty()) {
+        qDebug() << "没有配置邮件账户，跳过连接";
+        return;
     }
 
-    if (uiUpdateTimer) {
-        uiUpdateTimer->start();
+    qDebug() << "开始异步连接邮件服务器...";
+    // 只是加入各账户工作线程的队列，不会阻塞 UI
+    for (const auto &entry : accounts) {
+        AccountContext *context = entry.second.get();
+        if (!context->client->isConnected()) {
+            context->client->connectToServer(context->account);
+        }
     }
 }
 
-void MainWindow::onEmailConnectionFinished()
+void MainWindow::onMailboxChanged(const QString &account, const QString &folder)
 {
-    isConnecting.store(false);
-    qDebug() << "邮件连接操作完成";
+    qDebug() << "服务器推送邮箱变化:" << account << folder;
+    // 正在同步时工作线程会把这次请求排在后面，多次推送合并为一次同步
+    if (AccountContext *context = accountContext(account)) {
+        context->lastSync = QDateTime::currentDateTime();
+        context->client->fetchEmails();
+    }
 }
 
-void MainWindow::onEmailOperationFinished()
+void MainWindow::onIdleStateChanged(const QString &account, bool active)
 {
-    isOperating.store(false);
-    qDebug() << "邮件操作完成";
+    // IDLE 连接负责实时推送，定时同步只作为兜底
+    qDebug() << account << "IDLE 推送" << (active ? "已启用" : "已停止");
 }
 
 void MainWindow::onAccountChanged(const QString &email)
 {
     qDebug() << "切换到账户:" << email;
+    ui->searchEdit->clear();
+    // 所有账户都在后台同步，数据已在本地，切换只需更换模型
+    syncAccounts();
+    if (accountContext(email)) {
+        currentAccount = email;
+    }
+    if (currentView == AllInboxes) {
+        setCurrentView(Inbox);
+    } else {
+        updateEmailList();
+    }
     connectToEmailServerAsync();
 }
 
-void MainWindow::onEmailReceived(const QString &from, const QString &subject, const QString &body, bool isHtml, const QStringList &attachments)
+void MainWindow::onAccountsChanged()
+{
+    syncAccounts();
+    updateEmailList();
+    connectToEmailServerAsync();
+}
+
+void MainWindow::onEmailReceived(const Email &email)
 {
     // 线程安全地添加新邮件
-    QMetaObject::invokeMethod(this, [this, from, subject, body, isHtml, attachments]() {
-        Email newEmail;
-        newEmail.id = QUuid::createUuid().toString();
-        newEmail.sender = from;
-        newEmail.subject = subject;
-        newEmail.content = body;
-        newEmail.isHtml = isHtml;
-        newEmail.attachments = attachments;
-        newEmail.time = QDateTime::currentDateTime();
-        newEmail.isRead = false;
-        newEmail.isFavorite = false;
-
-        {
-            QMutexLocker locker(&emailMutex);
-            inboxEmails.prepend(newEmail);
+    QMetaObject::invokeMethod(this, [this, email]() {
+        AccountContext *context = accountContext(email.account);
+        // 同一封服务器邮件只保留一份
+        if (!context || !context->inbox->prependEmail(email)) {
+            return;
         }
+        // 统一收件箱混合了多个账户，按时间插入，而不是总放在最前面
+        unifiedModel->insertEmail(email);
+
+        showNotification("新邮件", QString("来自: %1\n主题: %2").arg(email.sender, email.subject));
+        qDebug() << "收到新邮件 - 发件人:" << email.sender << "主题:" << email.subject;
+    }, Qt::QueuedConnection);
+}
 
-        if (currentView == Inbox) {
-            updateEmailList();
+void MainWindow::onMailboxReset(const QString &account, const QString &folder)
+{
+    QMetaObject::invokeMethod(this, [this, account, folder]() {
+        AccountContext *context = accountContext(account);
+        if (!context) {
+            return;
         }
+        auto stale = [&account, &folder](const Email &email) {
+            return email.account == account && email.uid != 0 && email.folder == folder;
+        };
+        // 收藏、回收站和搜索结果中的同一批邮件带着作废的 UID，一并移除
+        for (MailboxModel *model : {context->inbox, context->sent, context->favorite, context->trash,
+                                    unifiedModel, searchModel}) {
+            model->removeIf(stale);
+        }
+        qDebug() << "文件夹需要重新同步:" << account << folder;
+    }, Qt::QueuedConnection);
+}
+
+void MainWindow::onEmailBodyReceived(const Email &email)
+{
+    QMetaObject::invokeMethod(this, [this, email]() {
+        updateEmail(email.account, email.id, [&email](Email &target) {
+            target.content = email.content;
+            target.isHtml = email.isHtml;
+            target.attachments = email.attachments;
+            target.bodyLoaded = true;
+        });
 
-        showNotification("新邮件", QString("来自: %1\n主题: %2").arg(from, subject));
-        qDebug() << "收到新邮件 - 发件人:" << from << "主题:" << subject;
+        if (currentEmailId == email.id && currentEmailAccount == email.account) {
+            AccountContext *context = accountContext(email.account);
+            Email *current = context ? context->inbox->find(email.account, email.id) : nullptr;
+            showEmailContent(current ? *current : email);
+        }
     }, Qt::QueuedConnection);
 }
 
-void MainWindow::onConnectionStatusChanged(bool connected)
+void MainWindow::onConnectionStatusChanged(const QString &account, bool connected)
 {
-    QMetaObject::invokeMethod(this, [this, connected]() {
-        updateUIState(connected);
-        if (connected) {
-            qDebug() << "邮件服务器连接成功";
-            performEmailOperationAsync([this]() {
-                emailClient->fetchEmails();
-            });
+    QMetaObject::invokeMethod(this, [this, account, connected]() {
+        if (account == currentAccount) {
+            updateUIState(connected);
+        }
+        AccountContext *context = accountContext(account);
+        if (connected && context) {
+            qDebug() << "邮件服务器连接成功:" << account;
+            context->lastSync = QDateTime::currentDateTime();
+            context->client->fetchEmails();
         } else {
-            qDebug() << "邮件服务器断开连接";
+            qDebug() << "邮件服务器断开连接:" << account;
         }
     }, Qt::QueuedConnection);
 }
 
-void MainWindow::onEmailSent(bool success)
+void MainWindow::onOutboxStateChanged(const QString &account, const QString &emailId, int state, const QString &error)
 {
-    QMetaObject::invokeMethod(this, [this, success]() {
-        if (success) {
-            QMessageBox::information(this, "发送成功", "邮件发送成功！");
-            if (currentView == Sent) {
-                updateEmailList();
-            }
-        } else {
-            QMessageBox::warning(this, "发送失败", "邮件发送失败，请检查网络连接和账户设置。");
+    QMetaObject::invokeMethod(this, [this, account, emailId, state, error]() {
+        updateEmail(account, emailId, [state, &error](Email &email) {
+            email.sendState = state;
+            email.sendError = error;
+        });
+        if (state == Outbox::Sent) {
+            qDebug() << "邮件发送成功:" << emailId;
         }
     }, Qt::QueuedConnection);
 }
 
-void MainWindow::onEmailError(const QString &error)
+void MainWindow::onEmailError(const QString &account, const QString &error)
 {
-    QMetaObject::invokeMethod(this, [this, error]() {
-        handleEmailError(error);
+    QMetaObject::invokeMethod(this, [this, account, error]() {
+        handleEmailError(accounts.size() > 1 ? QString("%1: %2").arg(account, error) : error);
+    }, Qt::QueuedConnection);
+}
+
+void MainWindow::onAttachmentProgress(const QString &account, const QString &emailId, int index,
+                                      qint64 received, qint64 total)
+{
+    QMetaObject::invokeMethod(this, [this, account, emailId, index, received, total]() {
+        QProgressDialog *dialog = attachmentDialogs.value(attachmentKey(account, emailId, index));
+        if (dialog && total > 0) {
+            dialog->setValue(static_cast<int>(std::min<qint64>(received * 100 / total, 100)));
+        }
+    }, Qt::QueuedConnection);
+}
+
+void MainWindow::onAttachmentSaved(const QString &account, const QString &emailId, int index,
+                                   const QString &path, const QString &error)
+{
+    QMetaObject::invokeMethod(this, [this, account, emailId, index, path, error]() {
+        // 对话框已被取消时不再提示
+        QProgressDialog *dialog = attachmentDialogs.take(attachmentKey(account, emailId, index));
+        if (!dialog) return;
+        // deleteLater 而不是 close，关闭对话框会发出 canceled
+        dialog->deleteLater();
+        if (error.isEmpty()) {
+            showNotification("附件已保存", path);
+        } else {
+            handleEmailError(error);
+        }
     }, Qt::QueuedConnection);
 }
 
 void MainWindow::checkNewEmails()
 {
-    if (emailClient && emailClient->isConnected()) {
-        performEmailOperationAsync([this]() {
-            emailClient->fetchEmails();
-        });
-    } else {
+    const QDateTime now = QDateTime::currentDateTime();
+    bool disconnected = false;
+    for (const auto &entry : accounts) {
+        AccountContext *context = entry.second.get();
+        if (!context->client->isConnected()) {
+            disconnected = true;
+            continue;
+        }
+        // 有 IDLE 推送的账户只需偶尔兜底同步
+        if (context->client->isIdleActive() && context->lastSync.isValid()
+            && context->lastSync.secsTo(now) < 15 * 60) {
+            continue;
+        }
+        context->lastSync = now;
+        context->client->fetchEmails();
+    }
+    if (disconnected) {
         connectToEmailServerAsync();
     }
 }
@@ -339,50 +579,38 @@ void MainWindow::handleEmailError(const QString &error)
 // UI 交互槽函数实现
 void MainWindow::onInboxClicked()
 {
-    currentView = Inbox;
-    ui->inboxButton->setChecked(true);
-    ui->sendButton->setChecked(false);
-    ui->favoriteButton->setChecked(false);
-    ui->trashButton->setChecked(false);
-    updateEmailList();
-    if (ui->favoriteContentButton) {
-        ui->favoriteContentButton->setVisible(false);
-    }
+    setCurrentView(Inbox);
+}
+
+void MainWindow::onUnifiedInboxClicked()
+{
+    setCurrentView(AllInboxes);
 }
 
 void MainWindow::onSendClicked()
 {
-    currentView = Sent;
-    ui->inboxButton->setChecked(false);
-    ui->sendButton->setChecked(true);
-    ui->favoriteButton->setChecked(false);
-    ui->trashButton->setChecked(false);
-    updateEmailList();
-    if (ui->favoriteContentButton) {
-        ui->favoriteContentButton->setVisible(false);
-    }
+    setCurrentView(Sent);
 }
 
 void MainWindow::onFavoriteClicked()
 {
-    currentView = Favorite;
-    ui->inboxButton->setChecked(false);
-    ui->sendButton->setChecked(false);
-    ui->favoriteButton->setChecked(true);
-    ui->trashButton->setChecked(false);
-    updateEmailList();
-    if (ui->favoriteContentButton) {
-        ui->favoriteContentButton->setVisible(false);
-    }
+    setCurrentView(Favorite);
 }
 
 void MainWindow::onTrashClicked()
 {
-    currentView = Trash;
-    ui->inboxButton->setChecked(false);
-    ui->sendButton->setChecked(false);
-    ui->favoriteButton->setChecked(false);
-    ui->trashButton->setChecked(true);
+    setCurrentView(Trash);
+}
+
+void MainWindow::setCurrentView(ViewType view)
+{
+    currentView = view;
+    ui->searchEdit->clear();
+    ui->inboxButton->setChecked(view == Inbox);
+    ui->unifiedInboxButton->setChecked(view == AllInboxes);
+    ui->sendButton->setChecked(view == Sent);
+    ui->favoriteButton->setChecked(view == Favorite);
+    ui->trashButton->setChecked(view == Trash);
     updateEmailList();
     if (ui->favoriteContentButton) {
         ui->favoriteContentButton->setVisible(false);
@@ -412,56 +640,76 @@ void MainWindow::onMinimizeClicked()
     }
 }
 
-void MainWindow::onEmailItemClicked(QListWidgetItem *item)
+void MainWindow::onEmailItemClicked(const QModelIndex &index)
 {
-    if (!item || !ui) return;
-
-    QString emailId = item->data(Qt::UserRole).toString();
-
-    QMutexLocker locker(&emailMutex);
-    QList<Email> *currentEmails = nullptr;
+    if (!index.isValid() || !ui) return;
+
+    MailboxModel *model = currentModel();
+    Email *email = model ? model->emailAt(index.row()) : nullptr;
+    if (!email) return;
+    // 统一收件箱中的邮件交给所属账户处理
+    AccountContext *context = accountContext(email->account);
+    if (!context) return;
+
+    // 正文已在本地存储中时不访问服务器
+    if (!email->bodyLoaded) {
+        context->store->loadBody(*email);
+    }
+    showEmailContent(*email);
 
-    switch(currentView) {
-    case Inbox: currentEmails = &inboxEmails; break;
-    case Sent: currentEmails = &sentEmails; break;
-    case Favorite: currentEmails = &favoriteEmails; break;
-    case Trash: currentEmails = &trashEmails; break;
+    if (!email->isRead) {
+        context->store->setFlag(*email, MailStore::Read, true);
+        updateEmail(email->account, email->id, [](Email &target) { target.isRead = true; });
     }
 
-    if (currentEmails) {
-        Email *email = findEmailById(emailId, *currentEmails);
-        if (email) {
-            showEmailContent(*email);
-            email->isRead = true;
-            updateEmailList();
-        }
+    // 列表只同步了邮件头，打开时再下载正文
+    if (!email->bodyLoaded) {
+        context->client->fetchEmailBody(*email);
     }
 }
 
 void MainWindow::onComposeClicked()
 {
+    AccountContext *context = currentContext();
+    if (!context) {
+        QMessageBox::information(this, "提示", "请先添加邮件账户");
+        return;
+    }
+
+    // 用户撰写邮件期间在后台建立 SMTP 连接
+    context->client->prepareSmtp();
+
     ComposeDialog dialog(this);
     if (dialog.exec() == QDialog::Accepted) {
         Email email = dialog.getEmail();
+        email.sender = context->account.email;
+        email.account = context->account.email;
 
-        if (accountDialog) {
-            EmailAccount currentAccount = accountDialog->getCurrentAccount();
-            email.sender = currentAccount.email;
-        }
-
-        performEmailOperationAsync([this, email]() {
-            if (emailClient) {
-                emailClient->sendEmail(email.sender, email.subject, email.content, email.attachments);
-            }
-        });
-
-        email.id = QUuid::createUuid().toString();
         email.time = QDateTime::currentDateTime();
-        sentEmails.prepend(email);
+        email.folder = "Sent";
+        email.isRead = true;
+        email.isFavorite = false;
+        if (!context->store->appendLocalEmail(email)) {
+            email.id = QUuid::createUuid().toString();
+        }
 
-        if (currentView == Sent) {
-            updateEmailList();
+        // 先写入发件箱再返回，由工作线程在后台发送，离线或程序退出也不会丢失
+        Outbox::Entry entry;
+        entry.account = context->account.email;
+        entry.emailId = email.id;
+        entry.to = dialog.getRecipients();
+        entry.subject = email.subject;
+        entry.body = email.content;
+        entry.isHtml = email.isHtml;
+        entry.attachments = email.attachments;
+        if (context->outbox->enqueue(entry)) {
+            email.sendState = Outbox::Queued;
+            context->client->flushOutbox();
+        } else {
+            email.sendState = Outbox::Failed;
+            email.sendError = "无法写入发件箱";
         }
+        context->sent->prependEmail(email);
     }
 }
 
@@ -482,25 +730,94 @@ void MainWindow::onFavoriteContentClicked()
 {
     if (currentEmailId.isEmpty() || !ui || !ui->favoriteContentButton) return;
 
-    QMutexLocker locker(&emailMutex);
-    Email *targetEmail = nullptr;
+    MailboxModel *model = currentModel();
+    AccountContext *context = accountContext(currentEmailAccount);
+    Email *targetEmail = model && context ? model->find(currentEmailAccount, currentEmailId) : nullptr;
 
-    switch(currentView) {
-    case Inbox: targetEmail = findEmailById(currentEmailId, inboxEmails); break;
-    case Sent: targetEmail = findEmailById(currentEmailId, sentEmails); break;
-    case Favorite: targetEmail = findEmailById(currentEmailId, favoriteEmails); break;
-    case Trash: targetEmail = findEmailById(currentEmailId, trashEmails); break;
+    if (targetEmail) {
+        const bool favorite = !targetEmail->isFavorite;
+        ui->favoriteContentButton->setChecked(favorite);
+        ui->favoriteContentButton->setText(favorite ? "已收藏" : "收藏");
+        context->store->setFlag(*targetEmail, MailStore::Favorite, favorite);
+        updateEmail(currentEmailAccount, currentEmailId, [favorite](Email &email) { email.isFavorite = favorite; });
+
+        if (favorite) {
+            // 先复制再插入，避免引用模型内部数据
+            context->favorite->prependEmail(Email(*targetEmail));
+        } else {
+            context->favorite->removeEmail(currentEmailAccount, currentEmailId);
+        }
     }
+}
 
-    if (targetEmail) {
-        targetEmail->isFavorite = !targetEmail->isFavorite;
-        ui->favoriteContentButton->setChecked(targetEmail->isFavorite);
-        ui->favoriteContentButton->setText(targetEmail->isFavorite ? "已收藏" : "收藏");
+void MainWindow::onSearchTextChanged(const QString &text)
+{
+    searchQuery = text.trimmed();
+    if (searchQuery.isEmpty()) {
+        searchModel->clear();
+        updateEmailList();
+        return;
+    }
 
-        if (currentView == Favorite) {
-            updateEmailList();
+    // 本地索引查询，不访问服务器；统一收件箱中搜索所有账户
+    QList<Email> results;
+    for (const auto &entry : accounts) {
+        AccountContext *context = entry.second.get();
+        if (currentView != AllInboxes && entry.first != currentAccount) {
+            continue;
+        }
+        const QStringList ids = context->store->search(searchQuery);
+        for (const QString &id : ids) {
+            for (MailboxModel *model : {context->inbox, context->sent, context->trash}) {
+                if (Email *email = model->find(entry.first, id)) {
+                    results.append(*email);
+                    break;
+                }
+            }
         }
     }
+    if (currentView == AllInboxes) {
+        std::stable_sort(results.begin(), results.end(), [](const Email &a, const Email &b) {
+            return a.time > b.time;
+        });
+    }
+
+    searchModel->setEmails(results);
+    updateEmailList();
+}
+
+void MainWindow::onEmailContentLinkClicked(const QUrl &url)
+{
+    if (url.scheme() != "attachment") return;
+    bool ok = false;
+    const int index = url.path().toInt(&ok);
+    AccountContext *context = accountContext(currentEmailAccount);
+    MailboxModel *model = currentModel();
+    Email *email = model ? model->find(currentEmailAccount, currentEmailId) : nullptr;
+    if (!ok || !context || !email || index < 0 || index >= email->attachments.size()) return;
+
+    const QString name = email->attachments[index];
+    const QString key = attachmentKey(email->account, email->id, index);
+    if (attachmentDialogs.contains(key)) return;
+
+    const QString downloads = QStandardPaths::writableLocation(QStandardPaths::DownloadLocation);
+    const QString path = QFileDialog::getSaveFileName(this, "保存附件", QDir(downloads).filePath(name));
+    if (path.isEmpty()) return;
+
+    // 小附件很快完成，不弹出进度对话框
+    QProgressDialog *dialog = new QProgressDialog(QString("正在下载 %1").arg(name), "取消", 0, 100, this);
+    dialog->setMinimumDuration(500);
+    dialog->setValue(0);
+    attachmentDialogs.insert(key, dialog);
+    EmailClient *client = context->client;
+    connect(dialog, &QProgressDialog::canceled, this, [this, key, client]() {
+        client->cancelPending();
+        if (QProgressDialog *canceled = attachmentDialogs.take(key)) {
+            canceled->deleteLater();
+        }
+    });
+
+    client->saveAttachment(*email, index, path);
 }
 
 // 系统托盘相关
@@ -564,11 +881,20 @@ void MainWindow::setupUI()
     )";
 
     if (ui->inboxButton) ui->inboxButton->setStyleSheet(buttonStyle);
+    if (ui->unifiedInboxButton) ui->unifiedInboxButton->setStyleSheet(buttonStyle);
     if (ui->sendButton) ui->sendButton->setStyleSheet(buttonStyle);
     if (ui->favoriteButton) ui->favoriteButton->setStyleSheet(buttonStyle);
     if (ui->trashButton) ui->trashButton->setStyleSheet(buttonStyle);
     if (ui->accountButton) ui->accountButton->setStyleSheet(buttonStyle);
     if (ui->settingButton) ui->settingButton->setStyleSheet(buttonStyle);
+
+    // 邮件列表：自绘列表项，所有行等高，滚动时不需要逐行计算尺寸
+    if (ui->emailList) {
+        ui->emailList->setItemDelegate(new MailItemDelegate(ui->emailList));
+        ui->emailList->setUniformItemSizes(true);
+        ui->emailList->setSelectionMode(QAbstractItemView::SingleSelection);
+        ui->emailList->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    }
 }
 
 void MainWindow::setupTitleBar()
@@ -611,48 +937,32 @@ void MainWindow::updateEmailList()
 {
     if (!ui || !ui->emailList) return;
 
-    ui->emailList->clear();
+    // 切换视图只需更换模型，列表内容由模型增量更新
+    MailboxModel *model = currentModel();
+    if (ui->emailList->model() == model) return;
 
-    QMutexLocker locker(&emailMutex);
-    QList<Email> *currentEmails = nullptr;
-
-    switch(currentView) {
-    case Inbox: currentEmails = &inboxEmails; break;
-    case Sent: currentEmails = &sentEmails; break;
-    case Favorite: currentEmails = &favoriteEmails; break;
-    case Trash: currentEmails = &trashEmails; break;
-    }
-
-    if (currentEmails) {
-        for (const Email &email : *currentEmails) {
-            QListWidgetItem *item = new QListWidgetItem();
-            QString displayText = QString("%1\n%2\n%3")
-                .arg(email.sender)
-                .arg(email.subject)
-                .arg(email.time.toString("MM-dd hh:mm"));
-
-            if (!email.isRead) {
-                displayText.prepend("● ");
-            }
-
-            item->setText(displayText);
-            item->setData(Qt::UserRole, email.id);
-            ui->emailList->addItem(item);
-        }
-    }
+    QItemSelectionModel *oldSelection = ui->emailList->selectionModel();
+    ui->emailList->setModel(model);
+    delete oldSelection;
 }
 
 void MainWindow::showEmailContent(const Email &email)
 {
     if (!ui) return;
 
-    QString content = email.isHtml ? email.content :
-        QString("<pre>%1</pre>").arg(email.content.toHtmlEscaped());
+    QString content;
+    if (!email.bodyLoaded) {
+        content = "<p>正在加载邮件内容...</p>";
+    } else {
+        content = email.isHtml ? email.content :
+            QString("<pre>%1</pre>").arg(email.content.toHtmlEscaped());
+    }
 
+    // 附件只列出名称，点击链接时才下载
     if (!email.attachments.isEmpty()) {
         content += "<hr><h4>附件:</h4><ul>";
-        for (const QString &attachment : email.attachments) {
-            content += QString("<li>%1</li>").arg(attachment);
+        for (int i = 0; i < email.attachments.size(); ++i) {
+            content += QString("<li><a href=\"attachment:%1\">%2</a></li>").arg(i).arg(email.attachments[i].toHtmlEscaped());
         }
         content += "</ul>";
     }
@@ -668,6 +978,7 @@ void MainWindow::showEmailContent(const Email &email)
     }
 
     currentEmailId = email.id;
+    currentEmailAccount = email.account;
 }
 
 void MainWindow::showNotification(const QString &title, const QString &message)
@@ -719,9 +1030,47 @@ void MainWindow::paintEvent(QPaintEvent *event)
 }
 
 // 辅助方法
-Email* MainWindow::findEmailById(const QString &id, QList<Email> &emailList)
+MailboxModel *MainWindow::currentModel() const
+{
+    if (!searchQuery.isEmpty()) {
+        return searchModel;
+    }
+
+    if (currentView == AllInboxes) {
+        return unifiedModel;
+    }
+    AccountContext *context = currentContext();
+    if (!context) {
+        return nullptr;
+    }
+
+    switch(currentView) {
+    case Inbox: return context->inbox;
+    case AllInboxes: return unifiedModel;
+    case Sent: return context->sent;
+    case Favorite: return context->favorite;
+    case Trash: return context->trash;
+    }
+    return nullptr;
+}
+
+void MainWindow::updateEmail(const QString &account, const QString &id, const std::function<void(Email &email)> &update)
+{
+    AccountContext *context = accountContext(account);
+    if (!context) {
+        return;
+    }
+    for (MailboxModel *model : {context->inbox, context->sent, context->favorite, context->trash,
+                                unifiedModel, searchModel}) {
+        Email *email = model->find(account, id);
+        if (email) {
+            update(*email);
+            model->emailChanged(account, id);
+        }
+    }
+}
+
+QString MainWindow::attachmentKey(const QString &account, const QString &emailId, int index)
 {
-    auto it = std::find_if(emailList.begin(), emailList.end(),
-        [&id](const Email &email) { return email.id == id; });
-    return (it != emailList.end()) ? &(*it) : nullptr;
+    return QString("%1/%2/%3").arg(account, emailId).arg(index);
 }
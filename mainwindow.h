@@ -7,23 +7,30 @@
 #include <QList>
 #include <QUuid>
 #include <QDateTime>
-#include <QListWidgetItem>
+#include <QModelIndex>
 #include <QMouseEvent>
 #include <QPaintEvent>
 #include <QPainterPath>
 #include <QPainter>
 #include <QThreadPool>
-#include <QFuture>
-#include <QFutureWatcher>
+#include <QHash>
+#include <QUrl>
+#include <QProgressDialog>
 #include <QMutex>
 #include <QWaitCondition>
+#include <QSemaphore>
 #include <atomic>
-#include <QtConcurrent/QtConcurrent>
+#include <functional>
+#include <map>
+#include <memory>
 
 #include "settingdialog.h"
 #include "trayicon.h"
 #include "accountdialog.h"
 #include "emailclient.h"
+#include "mailstore.h"
+#include "mailboxmodel.h"
+#include "outbox.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -46,82 +53,116 @@ protected:
 private slots:
     // UI 交互槽函数
     void onInboxClicked();
+    void onUnifiedInboxClicked();
     void onSendClicked();
     void onFavoriteClicked();
     void onTrashClicked();
     void onAccountClicked();
     void onSettingClicked();
     void onMinimizeClicked();
-    void onEmailItemClicked(QListWidgetItem *item);
+    void onEmailItemClicked(const QModelIndex &index);
     void onComposeClicked();
     void onReplyClicked();
     void onFavoriteContentClicked();
+    void onSearchTextChanged(const QString &text);
+    // 正文中附件链接的点击，选择保存位置后交给所属账户下载
+    void onEmailContentLinkClicked(const QUrl &url);
 
     // 系统托盘相关
     void trayIconActivated(QSystemTrayIcon::ActivationReason reason);
     void restoreFromTray();
     void toggleMaximize();
 
-    // 邮件客户端相关
-    void onEmailReceived(const QString &from, const QString &subject, const QString &body, bool isHtml, const QStringList &attachments);
-    void onConnectionStatusChanged(bool connected);
-    void onEmailSent(bool success);
-    void onEmailError(const QString &error);
+    // 邮件客户端相关，account 为发出信号的账户
+    void onEmailReceived(const Email &email);
+    void onMailboxReset(const QString &account, const QString &folder);
+    void onEmailBodyReceived(const Email &email);
+    void onAttachmentProgress(const QString &account, const QString &emailId, int index, qint64 received, qint64 total);
+    void onAttachmentSaved(const QString &account, const QString &emailId, int index, const QString &path,
+                           const QString &error);
+    void onMailboxChanged(const QString &account, const QString &folder);
+    void onIdleStateChanged(const QString &account, bool active);
+    void onConnectionStatusChanged(const QString &account, bool connected);
+    void onOutboxStateChanged(const QString &account, const QString &emailId, int state, const QString &error);
+    void onEmailError(const QString &account, const QString &error);
     void onAccountChanged(const QString &email);
+    void onAccountsChanged();
 
     // 定时任务
     void checkNewEmails();
 
-    // 线程相关
-    void onEmailConnectionFinished();
-    void onEmailOperationFinished();
-
 private:
+    // 每个账户一套连接、本地存储和视图模型，所有账户同时在后台同步，
+    // 切换账户只需更换模型
+    struct AccountContext {
+        EmailAccount account;
+        EmailClient *client = nullptr;
+        MailStore *store = nullptr;
+        Outbox *outbox = nullptr;
+        MailboxModel *inbox = nullptr;
+        MailboxModel *sent = nullptr;
+        MailboxModel *favorite = nullptr;
+        MailboxModel *trash = nullptr;
+        QDateTime lastSync;  // IDLE 可用时定时同步放宽到 15 分钟一次
+    };
+
     // UI 组件
     Ui::MainWindow *ui;
     SettingDialog *settingDialog;
     AccountDialog *accountDialog;
-    EmailClient *emailClient;
     TrayIcon *trayIcon;
 
+    // 按邮箱地址索引的账户
+    std::map<QString, std::unique_ptr<AccountContext>> accounts;
+    QString currentAccount;
+    // 所有账户共享的网络并发额度
+    QSemaphore *networkBudget;
+
     // 定时器
     QTimer *checkTimer;
-    QTimer *uiUpdateTimer;
 
-    // 线程管理
+    // 线程管理（网络操作由 EmailClient 的工作线程排队执行）
     QThreadPool *threadPool;
-    QFutureWatcher<void> *connectionWatcher;
-    QFutureWatcher<void> *operationWatcher;
 
     // 线程同步
-    mutable QMutex emailMutex;
     QWaitCondition emailCondition;
-    std::atomic<bool> isConnecting{false};
-    std::atomic<bool> isOperating{false};
 
     // 拖拽相关
     QPoint m_dragPosition;
     QString currentEmailId;
+    QString currentEmailAccount;
+    // 正在保存的附件的进度对话框，键由 attachmentKey() 生成
+    QHash<QString, QProgressDialog *> attachmentDialogs;
 
-    // 邮件数据
-    QList<Email> inboxEmails;
-    QList<Email> sentEmails;
-    QList<Email> favoriteEmails;
-    QList<Email> trashEmails;
+    // 邮件数据只在 GUI 线程中访问，各账户的模型在 AccountContext 中
+    MailboxModel *unifiedModel; // 所有账户的收件箱按时间合并
+    MailboxModel *searchModel;  // 搜索结果，搜索框非空时显示
+    QString searchQuery;
 
     // 当前视图状态
     enum ViewType {
         Inbox,
+        AllInboxes,
         Sent,
         Favorite,
         Trash
     } currentView;
 
+    static const int kNetworkConcurrency = 4;
+
     // 初始化方法
     void initializeComponents();
     void setupConnections();
     void setupThreading();
     void startInitialTasks();
+    // 按账户对话框中的配置创建或关闭账户
+    void syncAccounts();
+    AccountContext *openAccount(const EmailAccount &account);
+    void closeAccount(AccountContext *context);
+    AccountContext *accountContext(const QString &email) const;
+    AccountContext *currentContext() const;
+    void loadLocalEmails(AccountContext *context);
+    void rebuildUnifiedInbox();
 
     // UI 相关方法
     void setupUI();
@@ -131,14 +172,17 @@ private:
     void showEmailContent(const Email &email);
     void showNotification(const QString &title, const QString &message);
 
-    // 线程安全的邮件操作
+    // 连接所有尚未连接的账户
     void connectToEmailServerAsync();
-    void performEmailOperationAsync(const std::function<void()>& operation);
 
     // 辅助方法
     void updateUIState(bool connected);
     void handleEmailError(const QString &error);
-    Email* findEmailById(const QString &id, QList<Email> &emailList);
+    void setCurrentView(ViewType view);
+    MailboxModel *currentModel() const;
+    // 同一封邮件可能同时出现在多个视图中，修改后通知所有模型
+    void updateEmail(const QString &account, const QString &id, const std::function<void(Email &email)> &update);
+    static QString attachmentKey(const QString &account, const QString &emailId, int index);
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,636 @@
+#include "mimecodec.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+
+// x86 上提供 SSE4.1/AVX2 内核，运行时按 CPU 选择，其他平台只用标量实现
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MIMECODEC_X86 1
+#define MIMECODEC_TARGET(features) __attribute__((target(features)))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define MIMECODEC_X86 1
+#define MIMECODEC_TARGET(features)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace {
+
+const char kBase64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// 0x40 表示非字母表字符，0x80 表示填充符 '='
+const std::array<unsigned char, 256> kBase64Table = [] {
+    std::array<unsigned char, 256> table{};
+    table.fill(0x40);
+    for (int i = 0; i < 64; ++i) {
+        table[static_cast<unsigned char>(kBase64Alphabet[i])] = static_cast<unsigned char>(i);
+    }
+    table[static_cast<unsigned char>('=')] = 0x80;
+    return table;
+}();
+
+char *encodeBase64(const unsigned char *in, std::size_t size, char *out)
+{
+    std::size_t i = 0;
+    for (; i + 3 <= size; i += 3) {
+        const unsigned int group = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+        *out++ = kBase64Alphabet[(group >> 18) & 0x3F];
+        *out++ = kBase64Alphabet[(group >> 12) & 0x3F];
+        *out++ = kBase64Alphabet[(group >> 6) & 0x3F];
+        *out++ = kBase64Alphabet[group & 0x3F];
+    }
+    if (i < size) {
+        const unsigned int group = (in[i] << 16) | (i + 1 < size ? in[i + 1] << 8 : 0);
+        *out++ = kBase64Alphabet[(group >> 18) & 0x3F];
+        *out++ = kBase64Alphabet[(group >> 12) & 0x3F];
+        *out++ = i + 1 < size ? kBase64Alphabet[(group >> 6) & 0x3F] : '=';
+        *out++ = '=';
+    }
+    return out;
+}
+
+int hexValue(char ch)
+{
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    return -1;
+}
+
+// 向量内核：整块都是 Base64 字母时解码并返回 true，否则不写输出并返回 false
+using Base64Block = bool (*)(const char *in, char *out);
+// 向量内核：返回从 in 开始不含 '=' 的字节数（最多一块），这些字节已复制到 out
+using PlainRun = std::size_t (*)(const char *in, char *out);
+// 向量内核：把 base64EncodeInput 字节编码为 Base64 写入 out，会读取 base64EncodeRead 字节
+using Base64Encode = void (*)(const unsigned char *in, char *out);
+
+struct Kernels {
+    Base64Block base64Block = nullptr;
+    std::size_t base64BlockSize = 0;
+    PlainRun plainRun = nullptr;
+    std::size_t plainRunSize = 0;
+    Base64Encode base64Encode = nullptr;
+    std::size_t base64EncodeInput = 0;
+    std::size_t base64EncodeRead = 0;
+};
+
+#ifdef MIMECODEC_X86
+
+/*
+ * Base64 向量解码参考 Muła/Lemire 的 pshufb 查表法：
+ * 按高低半字节查表校验字符，再加上按高半字节查到的偏移得到 6 位值，
+ * 最后用 maddubs/madd 把每 4 个 6 位值拼成 3 个字节。
+ */
+MIMECODEC_TARGET("sse4.1")
+bool base64BlockSse(const char *in, char *out)
+{
+    const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                          0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask2F = _mm_set1_epi8(0x2F);
+
+    const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+    const __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(input, 4), mask2F);
+    const __m128i loNibbles = _mm_and_si128(input, mask2F);
+    const __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+    const __m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+    if (!_mm_testz_si128(lo, hi)) {
+        return false;
+    }
+
+    const __m128i eq2F = _mm_cmpeq_epi8(input, mask2F);
+    const __m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(eq2F, hiNibbles));
+    const __m128i values = _mm_add_epi8(input, roll);
+
+    const __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    const __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    const __m128i bytes = _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                                                 -1, -1, -1, -1));
+    alignas(16) char buffer[16];
+    _mm_store_si128(reinterpret_cast<__m128i *>(buffer), bytes);
+    std::memcpy(out, buffer, 12);
+    return true;
+}
+
+MIMECODEC_TARGET("avx2")
+bool base64BlockAvx2(const char *in, char *out)
+{
+    const __m256i lutLo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                           0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                           0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                           0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lutHi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                           0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                           0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                           0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lutRoll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                             0, 0, 0, 0, 0, 0, 0, 0,
+                                             0, 16, 19, 4, -65, -65, -71, -71,
+                                             0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask2F = _mm256_set1_epi8(0x2F);
+
+    const __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in));
+    const __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(input, 4), mask2F);
+    const __m256i loNibbles = _mm256_and_si256(input, mask2F);
+    const __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+    const __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+    if (!_mm256_testz_si256(lo, hi)) {
+        return false;
+    }
+
+    const __m256i eq2F = _mm256_cmpeq_epi8(input, mask2F);
+    const __m256i roll = _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(eq2F, hiNibbles));
+    const __m256i values = _mm256_add_epi8(input, roll);
+
+    const __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    const __m256i packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+    const __m256i lanes = _mm256_shuffle_epi8(packed, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                                       2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    // 两个 128 位通道各有 12 字节，拼成连续的 24 字节
+    const __m256i bytes = _mm256_permutevar8x32_epi32(lanes, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+    alignas(32) char buffer[32];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(buffer), bytes);
+    std::memcpy(out, buffer, 24);
+    return true;
+}
+
+/*
+ * Base64 向量编码同样参考 Muła 的方法：pshufb 把每 3 个字节复制成 4 字节一组，
+ * 用 mulhi/mullo 代替可变移位取出 4 个 6 位值，再按范围查表加上到 ASCII 的偏移。
+ * SSE 每次编码 12 字节（读取 16 字节），AVX2 的两个通道各 12 字节
+ */
+MIMECODEC_TARGET("sse4.1")
+__m128i base64EncodeLanes(__m128i input)
+{
+    const __m128i shuffled = _mm_shuffle_epi8(input, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(shuffled, _mm_set1_epi32(0x0FC0FC00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(shuffled, _mm_set1_epi32(0x003F03F0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    const __m128i indices = _mm_or_si128(t1, t3);
+
+    // 0..25 -> 13（'A'），26..51 -> 0（'a' - 26），52..61 -> 1..10（'0' - 52），62 -> 11，63 -> 12
+    __m128i reduced = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    reduced = _mm_or_si128(reduced, _mm_and_si128(less, _mm_set1_epi8(13)));
+    const __m128i shift = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                        '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(_mm_shuffle_epi8(shift, reduced), indices);
+}
+
+MIMECODEC_TARGET("sse4.1")
+void base64EncodeSse(const unsigned char *in, char *out)
+{
+    const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), base64EncodeLanes(input));
+}
+
+MIMECODEC_TARGET("avx2")
+void base64EncodeAvx2(const unsigned char *in, char *out)
+{
+    // 每个通道载入 12 字节的输入组，与 SSE 版本相同
+    const __m256i input = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 12)), 1);
+    const __m256i shuffled = _mm256_shuffle_epi8(input, _mm256_set_epi8(
+        10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+        10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m256i t0 = _mm256_and_si256(shuffled, _mm256_set1_epi32(0x0FC0FC00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(shuffled, _mm256_set1_epi32(0x003F03F0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    const __m256i indices = _mm256_or_si256(t1, t3);
+
+    __m256i reduced = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    reduced = _mm256_or_si256(reduced, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+    const __m256i shift = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                           '/' - 63, 'A', 0, 0,
+                                           'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                           '/' - 63, 'A', 0, 0);
+    const __m256i encoded = _mm256_add_epi8(_mm256_shuffle_epi8(shift, reduced), indices);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), encoded);
+}
+
+#if defined(__GNUC__)
+inline int countTrailingZeros(unsigned int mask) { return __builtin_ctz(mask); }
+#else
+inline int countTrailingZeros(unsigned int mask)
+{
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+}
+#endif
+
+// Quoted-Printable 正文绝大部分是普通字符，整块复制到下一个 '=' 为止。
+// 输出不会超过输入的位置，整块写入不会越界
+MIMECODEC_TARGET("sse4.1")
+std::size_t plainRunSse(const char *in, char *out)
+{
+    const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), input);
+    const unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(input, _mm_set1_epi8('='))));
+    return mask == 0 ? 16 : static_cast<std::size_t>(countTrailingZeros(mask));
+}
+
+MIMECODEC_TARGET("avx2")
+std::size_t plainRunAvx2(const char *in, char *out)
+{
+    const __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), input);
+    const unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(input, _mm256_set1_epi8('='))));
+    return mask == 0 ? 32 : static_cast<std::size_t>(countTrailingZeros(mask));
+}
+
+void detectCpu(bool &sse41, bool &avx2)
+{
+#if defined(__GNUC__)
+    __builtin_cpu_init();
+    sse41 = __builtin_cpu_supports("sse4.1");
+    avx2 = __builtin_cpu_supports("avx2");
+#else
+    int info[4];
+    __cpuid(info, 1);
+    sse41 = (info[2] & (1 << 19)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    // 操作系统需要保存 YMM 寄存器
+    const bool ymmEnabled = osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+    __cpuidex(info, 7, 0);
+    avx2 = ymmEnabled && (info[1] & (1 << 5)) != 0;
+#endif
+}
+
+#endif // MIMECODEC_X86
+
+const Kernels &kernels()
+{
+    static const Kernels selected = [] {
+        Kernels k;
+#ifdef MIMECODEC_X86
+        bool sse41 = false;
+        bool avx2 = false;
+        detectCpu(sse41, avx2);
+        if (avx2) {
+            k.base64Block = base64BlockAvx2;
+            k.base64BlockSize = 32;
+            k.plainRun = plainRunAvx2;
+            k.plainRunSize = 32;
+            k.base64Encode = base64EncodeAvx2;
+            k.base64EncodeInput = 24;
+            k.base64EncodeRead = 28;
+        } else if (sse41) {
+            k.base64Block = base64BlockSse;
+            k.base64BlockSize = 16;
+            k.plainRun = plainRunSse;
+            k.plainRunSize = 16;
+            k.base64Encode = base64EncodeSse;
+            k.base64EncodeInput = 12;
+            k.base64EncodeRead = 16;
+        }
+#endif
+        return k;
+    }();
+    return selected;
+}
+
+// 整组输入用向量内核编码，不足一块的尾部交给标量实现
+char *encodeBase64Fast(const unsigned char *in, std::size_t size, char *out)
+{
+    const Kernels &k = kernels();
+    std::size_t i = 0;
+    if (k.base64Encode) {
+        for (; i + k.base64EncodeRead <= size; i += k.base64EncodeInput) {
+            k.base64Encode(in + i, out);
+            out += k.base64EncodeInput / 3 * 4;
+        }
+    }
+    return encodeBase64(in + i, size - i, out);
+}
+
+// Strict 模式的校验，规则与 mailio 严格模式下的解码器一致
+void validateBase64(const char *in, std::size_t size)
+{
+    std::size_t count = 0;
+    std::size_t padding = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+        const char ch = in[i];
+        if (ch == '\r' || ch == '\n') {
+            continue;
+        }
+        const unsigned char value = kBase64Table[static_cast<unsigned char>(ch)];
+        if (value & 0x80) {
+            // 填充符只能出现在结尾，最多两个
+            if (++padding > 2) {
+                throw MimeCodec::DecodeError("Bad character.");
+            }
+        } else if ((value & 0x40) || padding > 0) {
+            throw MimeCodec::DecodeError("Bad character.");
+        }
+        ++count;
+    }
+    if (padding > 0 && count % 4 != 0) {
+        throw MimeCodec::DecodeError("Bad character.");
+    }
+}
+
+void validateQuotedPrintable(const char *in, std::size_t size)
+{
+    for (std::size_t i = 0; i < size; ++i) {
+        const unsigned char ch = static_cast<unsigned char>(in[i]);
+        if (ch == '=') {
+            // 软换行：'=' 后面只有空白直到行尾或数据结束
+            std::size_t j = i + 1;
+            while (j < size && (in[j] == ' ' || in[j] == '\t')) {
+                ++j;
+            }
+            if (j == size || in[j] == '\r' || in[j] == '\n') {
+                i = j - 1;
+                continue;
+            }
+            if (i + 2 >= size || hexValue(in[i + 1]) < 0 || hexValue(in[i + 2]) < 0) {
+                throw MimeCodec::DecodeError("Bad hexadecimal digit.");
+            }
+            i += 2;
+            continue;
+        }
+        if (ch != ' ' && ch != '\t' && ch != '\r' && ch != '\n' && (ch < 33 || ch > 126)) {
+            throw MimeCodec::DecodeError("Bad character.");
+        }
+    }
+}
+
+} // namespace
+
+namespace MimeCodec {
+
+std::size_t base64Decode(const char *in, std::size_t size, char *out, Mode mode)
+{
+    if (mode == Mode::Strict) {
+        validateBase64(in, size);
+    }
+    const Kernels &k = kernels();
+    char *start = out;
+    unsigned int quad = 0;
+    int count = 0;
+
+    std::size_t i = 0;
+    while (i < size) {
+        // 四字符组对齐时整块解码，遇到换行等非字母字符的块交给标量处理
+        if (count == 0 && k.base64Block) {
+            while (i + k.base64BlockSize <= size && k.base64Block(in + i, out)) {
+                i += k.base64BlockSize;
+                out += k.base64BlockSize / 4 * 3;
+            }
+            if (i == size) {
+                break;
+            }
+        }
+
+        const unsigned char value = kBase64Table[static_cast<unsigned char>(in[i++])];
+        if (value & 0x80) {
+            break;
+        }
+        if (value & 0x40) {
+            continue;
+        }
+        quad = (quad << 6) | value;
+        if (++count == 4) {
+            *out++ = static_cast<char>(quad >> 16);
+            *out++ = static_cast<char>(quad >> 8);
+            *out++ = static_cast<char>(quad);
+            quad = 0;
+            count = 0;
+        }
+    }
+
+    // 末尾不足四个字符（带或不带填充）
+    if (count == 2) {
+        *out++ = static_cast<char>(quad >> 4);
+    } else if (count == 3) {
+        *out++ = static_cast<char>(quad >> 10);
+        *out++ = static_cast<char>(quad >> 2);
+    }
+    return static_cast<std::size_t>(out - start);
+}
+
+std::size_t quotedPrintableDecode(const char *in, std::size_t size, char *out, Mode mode)
+{
+    if (mode == Mode::Strict) {
+        validateQuotedPrintable(in, size);
+    }
+    const Kernels &k = kernels();
+    char *start = out;
+    std::size_t i = 0;
+    while (i < size) {
+        if (k.plainRun) {
+            while (i + k.plainRunSize <= size) {
+                const std::size_t run = k.plainRun(in + i, out);
+                i += run;
+                out += run;
+                if (run < k.plainRunSize) {
+                    break;
+                }
+            }
+            if (i == size) {
+                break;
+            }
+        }
+
+        const char ch = in[i];
+        if (ch != '=') {
+            *out++ = ch;
+            ++i;
+            continue;
+        }
+
+        // 软换行：'=' 后面只有空白直到行尾
+        std::size_t j = i + 1;
+        while (j < size && (in[j] == ' ' || in[j] == '\t')) {
+            ++j;
+        }
+        if (j < size && (in[j] == '\r' || in[j] == '\n')) {
+            i = (in[j] == '\r' && j + 1 < size && in[j + 1] == '\n') ? j + 2 : j + 1;
+            continue;
+        }
+        if (j == size) {
+            break;
+        }
+
+        const int high = i + 1 < size ? hexValue(in[i + 1]) : -1;
+        const int low = i + 2 < size ? hexValue(in[i + 2]) : -1;
+        if (high >= 0 && low >= 0) {
+            *out++ = static_cast<char>((high << 4) | low);
+            i += 3;
+        } else {
+            *out++ = ch;
+            ++i;
+        }
+    }
+    return static_cast<std::size_t>(out - start);
+}
+
+std::string base64Decode(std::string_view encoded, Mode mode)
+{
+    std::string decoded(base64DecodedBound(encoded.size()), '\0');
+    decoded.resize(base64Decode(encoded.data(), encoded.size(), decoded.data(), mode));
+    return decoded;
+}
+
+std::string quotedPrintableDecode(std::string_view encoded, Mode mode)
+{
+    std::string decoded(encoded.size(), '\0');
+    decoded.resize(quotedPrintableDecode(encoded.data(), encoded.size(), decoded.data(), mode));
+    return decoded;
+}
+
+std::size_t base64EncodeLines(const char *in, std::size_t size, char *out)
+{
+    const unsigned char *data = reinterpret_cast<const unsigned char *>(in);
+    char *start = out;
+    for (std::size_t offset = 0; offset < size; offset += kBase64LineInput) {
+        out = encodeBase64Fast(data + offset, std::min(kBase64LineInput, size - offset), out);
+        *out++ = '\r';
+        *out++ = '\n';
+    }
+    return static_cast<std::size_t>(out - start);
+}
+
+std::string base64Encode(std::string_view data)
+{
+    std::string encoded((data.size() + 2) / 3 * 4, '\0');
+    encodeBase64Fast(reinterpret_cast<const unsigned char *>(data.data()), data.size(), encoded.data());
+    return encoded;
+}
+
+StreamDecoder::StreamDecoder(std::string_view transferEncoding)
+{
+    std::string encoding(transferEncoding);
+    std::transform(encoding.begin(), encoding.end(), encoding.begin(), [](unsigned char ch) {
+        return static_cast<char>(std::tolower(ch));
+    });
+    if (encoding == "base64") {
+        m_encoding = Base64;
+    } else if (encoding == "quoted-printable") {
+        m_encoding = QuotedPrintable;
+    }
+}
+
+void StreamDecoder::decode(std::string_view chunk, std::string &out)
+{
+    if (m_encoding == Identity) {
+        out.append(chunk.data(), chunk.size());
+        return;
+    }
+    // 整块解码在填充符处结束，之后的数据同样忽略
+    if (m_ended) {
+        return;
+    }
+
+    // 上次留下的尾部只用 chunk 的开头补全，其余部分直接解码，不复制整块
+    if (!m_pending.empty()) {
+        const std::size_t head = pendingCompletion(chunk);
+        m_pending.append(chunk.data(), head);
+        chunk.remove_prefix(head);
+        const std::size_t complete = completeLength(m_pending);
+        decodeInto(std::string_view(m_pending).substr(0, complete), out);
+        m_pending.erase(0, complete);
+        if (!m_pending.empty() || m_ended) {
+            return;
+        }
+    }
+    const std::size_t complete = completeLength(chunk);
+    decodeInto(chunk.substr(0, complete), out);
+    m_pending.assign(chunk.data() + complete, chunk.size() - complete);
+}
+
+void StreamDecoder::finish(std::string &out)
+{
+    if (m_ended) {
+        return;
+    }
+    decodeInto(m_pending, out);
+    m_pending.clear();
+}
+
+std::size_t StreamDecoder::completeLength(std::string_view data)
+{
+    if (m_encoding == Base64) {
+        // 截到最后一个完整的四字符组之后，遇到填充符说明数据已经结束。
+        // 先无分支地统计字母表字符，再从尾部退回不完整的那一组
+        std::size_t count = 0;
+        unsigned char flags = 0;
+        for (const char ch : data) {
+            const unsigned char value = kBase64Table[static_cast<unsigned char>(ch)];
+            count += !(value & 0x40);
+            flags |= value;
+        }
+        if (flags & 0x80) {
+            m_ended = true;
+            return data.size();
+        }
+        std::size_t end = data.size();
+        for (std::size_t partial = count % 4; partial > 0; --end) {
+            if (!(kBase64Table[static_cast<unsigned char>(data[end - 1])] & 0x40)) {
+                --partial;
+            }
+        }
+        return end;
+    }
+
+    // Quoted-Printable：'=' 的含义要看到行尾才能确定（软换行、"=XX" 或原样保留），
+    // 在换行之后截断，两边的解码互不影响
+    const std::size_t newline = data.rfind('\n');
+    return newline == std::string_view::npos ? 0 : newline + 1;
+}
+
+std::size_t StreamDecoder::pendingCompletion(std::string_view chunk) const
+{
+    if (m_encoding == Base64) {
+        // m_pending 以不完整的四字符组开头，补足缺少的字符（或读到填充符）为止
+        std::size_t count = 0;
+        for (const char ch : m_pending) {
+            count += !(kBase64Table[static_cast<unsigned char>(ch)] & 0x40);
+        }
+        std::size_t needed = (4 - count % 4) % 4;
+        for (std::size_t i = 0; i < chunk.size(); ++i) {
+            const unsigned char value = kBase64Table[static_cast<unsigned char>(chunk[i])];
+            if ((value & 0x80) || (!(value & 0x40) && --needed == 0)) {
+                return i + 1;
+            }
+        }
+        return chunk.size();
+    }
+
+    // Quoted-Printable：m_pending 是不完整的一行，补到第一个换行
+    const std::size_t newline = chunk.find('\n');
+    return newline == std::string_view::npos ? chunk.size() : newline + 1;
+}
+
+void StreamDecoder::decodeInto(std::string_view data, std::string &out) const
+{
+    if (data.empty()) {
+        return;
+    }
+    const std::size_t offset = out.size();
+    if (m_encoding == Base64) {
+        out.resize(offset + base64DecodedBound(data.size()));
+        out.resize(offset + base64Decode(data.data(), data.size(), out.data() + offset));
+    } else if (m_encoding == QuotedPrintable) {
+        out.resize(offset + data.size());
+        out.resize(offset + quotedPrintableDecode(data.data(), data.size(), out.data() + offset));
+    } else {
+        out.append(data.data(), data.size());
+    }
+}
+
+} // namespace MimeCodec
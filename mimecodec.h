@@ -0,0 +1,86 @@
+#ifndef MIMECODEC_H
+#define MIMECODEC_H
+
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <cstddef>
+
+/*
+ * 传输编码的编解码（Base64、Quoted-Printable）
+ *
+ * 直接在连续缓冲区上工作，输出写入调用方预先分配的空间，不按行拆分字符串。
+ * x86 上运行时选择 AVX2 或 SSE4.1 内核，其他情况使用标量实现，结果完全一致。
+ *
+ * 解码有两种模式。Lenient（默认）用于显示收到的邮件：Base64 跳过换行和非字母表字符，
+ * Quoted-Printable 保留无法解析的 '='。Strict 与 mailio 编解码器的严格模式一致，
+ * 遇到非法输入抛出 DecodeError，而不是猜测发件人的意图。
+ * benchmarks/mimecodec 下有吞吐量测试。
+ */
+namespace MimeCodec {
+
+enum class Mode { Lenient, Strict };
+
+// Strict 模式下的非法输入，消息与 mailio::codec_error 相同
+class DecodeError : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// 解码后长度的上限，用于预分配输出
+inline std::size_t base64DecodedBound(std::size_t encodedSize) { return encodedSize / 4 * 3 + 3; }
+
+// 返回写入 out 的字节数。out 至少要有 base64DecodedBound(size) 字节，
+// Quoted-Printable 至少要有 size 字节（向量内核会整块写入）。
+// Strict 模式下 Base64 只允许字母表字符、换行和结尾的填充符，
+// Quoted-Printable 只允许可打印 ASCII、空白、换行、"=XX" 和软换行
+std::size_t base64Decode(const char *in, std::size_t size, char *out, Mode mode = Mode::Lenient);
+std::size_t quotedPrintableDecode(const char *in, std::size_t size, char *out, Mode mode = Mode::Lenient);
+
+std::string base64Decode(std::string_view encoded, Mode mode = Mode::Lenient);
+std::string quotedPrintableDecode(std::string_view encoded, Mode mode = Mode::Lenient);
+
+// Base64 编码，每 76 个字符换行（CRLF），最后一行也以 CRLF 结束。
+// 按 kBase64LineInput 的整数倍分段编码时，各段输出直接拼接即可
+const std::size_t kBase64LineInput = 57;
+inline std::size_t base64EncodedLinesSize(std::size_t size)
+{
+    return (size + kBase64LineInput - 1) / kBase64LineInput * 2 + (size + 2) / 3 * 4;
+}
+std::size_t base64EncodeLines(const char *in, std::size_t size, char *out);
+// 不换行的 Base64，用于 RFC 2047 编码字
+std::string base64Encode(std::string_view data);
+
+// 分块到达的正文的增量解码（如 IMAP 分段 FETCH 的附件），宽松模式。
+// 每块只解码完整的部分：Base64 到最后一个完整的四字符组，Quoted-Printable 到最后一个换行，
+// 其余留到下一块，因此无论怎样分块，结果都与整块解码相同
+class StreamDecoder
+{
+public:
+    // transferEncoding 为 Content-Transfer-Encoding 的值，不区分大小写，
+    // 7bit、8bit、binary 等原样输出
+    explicit StreamDecoder(std::string_view transferEncoding);
+
+    // 解码结果追加到 out
+    void decode(std::string_view chunk, std::string &out);
+    // 数据结束时调用，输出剩余的尾部
+    void finish(std::string &out);
+
+private:
+    enum Encoding { Identity, Base64, QuotedPrintable };
+
+    // data 中可以立即解码的前缀长度，Base64 遇到填充符时记下数据已结束
+    std::size_t completeLength(std::string_view data);
+    // 补全 m_pending 所需的 chunk 开头长度
+    std::size_t pendingCompletion(std::string_view chunk) const;
+    void decodeInto(std::string_view data, std::string &out) const;
+
+    Encoding m_encoding = Identity;
+    std::string m_pending;
+    bool m_ended = false;   // Base64 已遇到填充符，之后的数据忽略
+};
+
+} // namespace MimeCodec
+
+#endif // MIMECODEC_H
@@ -0,0 +1,436 @@
+#include "mimeview.h"
+#include "mimecodec.h"
+#include <algorithm>
+#include <cctype>
+#include <map>
+
+namespace {
+
+bool iequals(std::string_view a, std::string_view b)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+std::string_view trim(std::string_view text)
+{
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+std::string toLower(std::string_view text)
+{
+    std::string result(text);
+    std::transform(result.begin(), result.end(), result.begin(), [](unsigned char ch) {
+        return static_cast<char>(std::tolower(ch));
+    });
+    return result;
+}
+
+// 头部值中分号之前的部分，如 "text/plain; charset=utf-8" 中的 "text/plain"
+std::string_view primaryValue(std::string_view value)
+{
+    return trim(value.substr(0, value.find(';')));
+}
+
+std::string percentDecode(std::string_view text)
+{
+    std::string result;
+    result.reserve(text.size());
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '%' && i + 2 < text.size()
+            && std::isxdigit(static_cast<unsigned char>(text[i + 1]))
+            && std::isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+            result.push_back(static_cast<char>(std::stoi(std::string(text.substr(i + 1, 2)), nullptr, 16)));
+            i += 2;
+        } else {
+            result.push_back(text[i]);
+        }
+    }
+    return result;
+}
+
+// 解析 "; key=value; key2="quoted value"" 形式的参数，键转为小写
+std::vector<std::pair<std::string, std::string>> parseParameters(std::string_view value)
+{
+    std::vector<std::pair<std::string, std::string>> params;
+    std::size_t pos = value.find(';');
+    while (pos != std::string_view::npos && pos < value.size()) {
+        ++pos;
+        const std::size_t eq = value.find('=', pos);
+        if (eq == std::string_view::npos) {
+            break;
+        }
+        std::string key = toLower(trim(value.substr(pos, eq - pos)));
+
+        std::size_t i = eq + 1;
+        while (i < value.size() && std::isspace(static_cast<unsigned char>(value[i]))) {
+            ++i;
+        }
+
+        std::string param;
+        if (i < value.size() && value[i] == '"') {
+            for (++i; i < value.size() && value[i] != '"'; ++i) {
+                if (value[i] == '\\' && i + 1 < value.size()) {
+                    ++i;
+                }
+                param.push_back(value[i]);
+            }
+            pos = value.find(';', i);
+        } else {
+            pos = value.find(';', i);
+            param = std::string(trim(value.substr(i, pos == std::string_view::npos ? std::string_view::npos : pos - i)));
+        }
+        params.emplace_back(std::move(key), std::move(param));
+    }
+    return params;
+}
+
+} // namespace
+
+MimeView::MimeView()
+{
+    m_parts.emplace_back();
+}
+
+void MimeView::feed(std::string_view chunk)
+{
+    if (m_finished || chunk.empty()) {
+        return;
+    }
+    m_buffer.append(chunk.data(), chunk.size());
+    parseLines();
+}
+
+void MimeView::finish()
+{
+    if (m_finished) {
+        return;
+    }
+
+    // 最后一行可能没有换行符
+    if (m_parsed < m_buffer.size()) {
+        handleLine(m_parsed, m_buffer.size(), m_buffer.size());
+        m_parsed = m_buffer.size();
+    }
+    if (m_state == InHeaders) {
+        endHeaders(m_buffer.size());
+    }
+
+    for (Part &part : m_parts) {
+        if (!part.closed) {
+            part.body.length = m_buffer.size() - std::min(part.body.offset, m_buffer.size());
+            part.closed = true;
+        }
+    }
+    m_multiparts.clear();
+    m_finished = true;
+}
+
+void MimeView::parseLines()
+{
+    while (true) {
+        const std::size_t newline = m_buffer.find('\n', m_parsed);
+        if (newline == std::string::npos) {
+            break;
+        }
+        std::size_t end = newline;
+        if (end > m_parsed && m_buffer[end - 1] == '\r') {
+            --end;
+        }
+        handleLine(m_parsed, end, newline + 1);
+        m_parsed = newline + 1;
+    }
+}
+
+void MimeView::handleLine(std::size_t start, std::size_t end, std::size_t next)
+{
+    const std::string_view line = std::string_view(m_buffer).substr(start, end - start);
+
+    if (m_state == InHeaders) {
+        if (line.empty()) {
+            endHeaders(next);
+            return;
+        }
+
+        Part &part = m_parts[static_cast<std::size_t>(m_current)];
+        if ((line.front() == ' ' || line.front() == '\t') && !part.headers.empty()) {
+            // 折行，值延续到本行末尾
+            Span &value = part.headers.back().second;
+            value.length = end - value.offset;
+            return;
+        }
+
+        const std::size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            return;
+        }
+        Span name{start, trim(line.substr(0, colon)).size()};
+        std::size_t valueStart = start + colon + 1;
+        while (valueStart < end && (m_buffer[valueStart] == ' ' || m_buffer[valueStart] == '\t')) {
+            ++valueStart;
+        }
+        part.headers.emplace_back(name, Span{valueStart, end - valueStart});
+        return;
+    }
+
+    if (m_multiparts.empty() || line.size() < 2 || line[0] != '-' || line[1] != '-') {
+        return;
+    }
+
+    bool closing = false;
+    const int multipart = matchBoundary(line, closing);
+    if (multipart < 0) {
+        return;
+    }
+
+    // 分隔符结束当前部分，以及所有嵌套在其中尚未闭合的 multipart
+    if (m_current != multipart) {
+        closeBody(m_current, start);
+    }
+    while (m_multiparts.back() != multipart) {
+        closeBody(m_multiparts.back(), start);
+        m_multiparts.pop_back();
+    }
+
+    if (closing) {
+        closeBody(multipart, start);
+        m_multiparts.pop_back();
+        m_current = multipart;
+        m_state = InBody;
+        return;
+    }
+
+    Part child;
+    child.parent = multipart;
+    m_parts.push_back(std::move(child));
+    m_current = static_cast<int>(m_parts.size()) - 1;
+    m_parts[static_cast<std::size_t>(multipart)].children.push_back(m_current);
+    m_state = InHeaders;
+}
+
+void MimeView::endHeaders(std::size_t bodyStart)
+{
+    Part &part = m_parts[static_cast<std::size_t>(m_current)];
+    part.body.offset = bodyStart;
+    m_state = InBody;
+
+    const std::string contentType = header(m_current, "Content-Type");
+    part.mediaType = toLower(primaryValue(contentType));
+    if (part.mediaType.empty()) {
+        const bool digest = part.parent >= 0
+            && m_parts[static_cast<std::size_t>(part.parent)].mediaType == "multipart/digest";
+        part.mediaType = digest ? "message/rfc822" : "text/plain";
+    }
+
+    if (part.mediaType.compare(0, 10, "multipart/") == 0) {
+        part.boundary = parameter(m_current, "Content-Type", "boundary");
+        if (!part.boundary.empty()) {
+            m_multiparts.push_back(m_current);
+        }
+    }
+}
+
+void MimeView::closeBody(int index, std::size_t lineStart)
+{
+    Part &part = m_parts[static_cast<std::size_t>(index)];
+    if (part.closed) {
+        return;
+    }
+
+    // 分隔符前的换行属于分隔符
+    std::size_t end = lineStart;
+    if (end >= 2 && m_buffer[end - 2] == '\r' && m_buffer[end - 1] == '\n') {
+        end -= 2;
+    } else if (end >= 1 && m_buffer[end - 1] == '\n') {
+        end -= 1;
+    }
+    end = std::max(end, part.body.offset);
+    part.body.length = end - part.body.offset;
+    part.closed = true;
+}
+
+int MimeView::matchBoundary(std::string_view line, bool &closing) const
+{
+    for (auto it = m_multiparts.rbegin(); it != m_multiparts.rend(); ++it) {
+        const std::string &boundary = m_parts[static_cast<std::size_t>(*it)].boundary;
+        if (line.size() < boundary.size() + 2 || line.compare(2, boundary.size(), boundary) != 0) {
+            continue;
+        }
+        std::string_view rest = line.substr(boundary.size() + 2);
+        closing = rest.size() >= 2 && rest[0] == '-' && rest[1] == '-';
+        if (closing) {
+            rest.remove_prefix(2);
+        }
+        if (trim(rest).empty()) {
+            return *it;
+        }
+    }
+    return -1;
+}
+
+bool MimeView::isMultipart(int index) const
+{
+    return !part(index).boundary.empty();
+}
+
+std::string_view MimeView::rawHeader(int index, std::string_view name) const
+{
+    for (const auto &header : part(index).headers) {
+        if (iequals(view(header.first), name)) {
+            return view(header.second);
+        }
+    }
+    return std::string_view();
+}
+
+std::string MimeView::header(int index, std::string_view name) const
+{
+    const std::string_view raw = rawHeader(index, name);
+    std::string value;
+    value.reserve(raw.size());
+    for (char ch : raw) {
+        if (ch != '\r' && ch != '\n') {
+            value.push_back(ch);
+        }
+    }
+    return std::string(trim(value));
+}
+
+std::string MimeView::parameter(int index, std::string_view headerName, std::string_view key,
+                                std::string *charset) const
+{
+    const std::string value = header(index, headerName);
+    if (value.empty()) {
+        return std::string();
+    }
+    return combineParameter(parseParameters(value), key, charset);
+}
+
+std::string MimeView::combineParameter(std::vector<std::pair<std::string, std::string>> params,
+                                       std::string_view key, std::string *charset)
+{
+    const std::string plainKey = toLower(key);
+    const std::string extendedKey = plainKey + "*";
+    std::string plain;
+    std::string extended;
+    bool hasExtended = false;
+    std::map<int, std::pair<bool, std::string>> sections;  // RFC 2231 续行 key*0、key*1*...
+
+    for (auto &param : params) {
+        const std::string &name = param.first;
+        if (name == plainKey) {
+            plain = std::move(param.second);
+        } else if (name == extendedKey) {
+            extended = std::move(param.second);
+            hasExtended = true;
+        } else if (name.size() > extendedKey.size() && name.compare(0, extendedKey.size(), extendedKey) == 0) {
+            std::string number = name.substr(extendedKey.size());
+            const bool encoded = !number.empty() && number.back() == '*';
+            if (encoded) {
+                number.pop_back();
+            }
+            if (!number.empty() && std::all_of(number.begin(), number.end(), ::isdigit)) {
+                sections[std::stoi(number)] = {encoded, std::move(param.second)};
+            }
+        }
+    }
+
+    // charset'language'percent-encoded，去掉前缀后返回编码部分
+    auto stripCharset = [charset](std::string_view text) {
+        const std::size_t first = text.find('\'');
+        const std::size_t second = first == std::string_view::npos ? first : text.find('\'', first + 1);
+        if (second == std::string_view::npos) {
+            return text;
+        }
+        if (charset) {
+            *charset = std::string(text.substr(0, first));
+        }
+        return text.substr(second + 1);
+    };
+
+    if (hasExtended) {
+        return percentDecode(stripCharset(extended));
+    }
+
+    if (!sections.empty()) {
+        // 只有带 * 的段需要百分号解码，charset 在第一段
+        std::string joined;
+        bool first = true;
+        for (const auto &section : sections) {
+            std::string_view text = section.second.second;
+            if (section.second.first) {
+                joined += percentDecode(first ? stripCharset(text) : text);
+            } else {
+                joined.append(text.data(), text.size());
+            }
+            first = false;
+        }
+        return joined;
+    }
+
+    return plain;
+}
+
+std::string MimeView::charset(int index) const
+{
+    return toLower(parameter(index, "Content-Type", "charset"));
+}
+
+std::string MimeView::transferEncoding(int index) const
+{
+    return toLower(header(index, "Content-Transfer-Encoding"));
+}
+
+std::string MimeView::fileName(int index, std::string *charset) const
+{
+    std::string name = parameter(index, "Content-Disposition", "filename", charset);
+    if (name.empty()) {
+        name = parameter(index, "Content-Type", "name", charset);
+    }
+    return name;
+}
+
+bool MimeView::isAttachment(int index) const
+{
+    if (isMultipart(index)) {
+        return false;
+    }
+    const std::string disposition = toLower(primaryValue(header(index, "Content-Disposition")));
+    if (disposition == "attachment") {
+        return true;
+    }
+    if (disposition == "inline" && part(index).mediaType.compare(0, 5, "text/") == 0) {
+        return false;
+    }
+    return !fileName(index).empty();
+}
+
+std::string_view MimeView::body(int index) const
+{
+    const Part &p = part(index);
+    if (p.closed) {
+        return view(p.body);
+    }
+    const std::size_t offset = std::min(p.body.offset, m_buffer.size());
+    return std::string_view(m_buffer).substr(offset);
+}
+
+std::string MimeView::decodedBody(int index) const
+{
+    const std::string_view raw = body(index);
+    const std::string encoding = transferEncoding(index);
+    if (encoding == "base64") {
+        return MimeCodec::base64Decode(raw);
+    }
+    if (encoding == "quoted-printable") {
+        return MimeCodec::quotedPrintableDecode(raw);
+    }
+    return std::string(raw);
+}
@@ -0,0 +1,93 @@
+#ifndef MIMEVIEW_H
+#define MIMEVIEW_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+/*
+ * 流式 MIME 解析
+ *
+ * mailio::mime 需要整封邮件作为一个字符串，并把每一行、每个部分复制一遍，
+ * 大附件会占用数倍于邮件大小的内存。MimeView 只保存一份原始数据：
+ * 网络数据分段 feed() 进来，解析时只记录各个头部和部分在缓冲区中的位置，
+ * 正文的传输编码在调用 decodedBody() 时才按部分解码。
+ *
+ * 返回的 string_view 指向内部缓冲区，在下一次 feed() 之前有效。
+ */
+class MimeView
+{
+public:
+    struct Span {
+        std::size_t offset = 0;
+        std::size_t length = 0;
+    };
+
+    struct Part {
+        std::vector<std::pair<Span, Span>> headers;  // 名称、原始值（可能包含折行）
+        Span body;                                   // 未解码的正文
+        int parent = -1;
+        std::vector<int> children;
+        std::string mediaType;                       // 小写，如 "text/plain"
+        std::string boundary;                        // multipart 的分隔符
+        bool closed = false;
+    };
+
+    MimeView();
+
+    void reserve(std::size_t size) { m_buffer.reserve(size); }
+    void feed(std::string_view chunk);
+    // 数据全部到达后调用，结束所有未闭合的部分
+    void finish();
+
+    const std::string &buffer() const { return m_buffer; }
+    std::size_t size() const { return m_buffer.size(); }
+
+    // 第 0 个部分是整封邮件
+    int partCount() const { return static_cast<int>(m_parts.size()); }
+    const Part &part(int index) const { return m_parts[static_cast<std::size_t>(index)]; }
+    bool isMultipart(int index) const;
+
+    std::string_view rawHeader(int index, std::string_view name) const;
+    // 去掉折行后的头部值
+    std::string header(int index, std::string_view name) const;
+    // 头部参数（如 Content-Type 的 charset），支持 RFC 2231 的 name*=charset''value 形式，
+    // 此时返回百分号解码后的字节，charset 写入 *charset
+    std::string parameter(int index, std::string_view headerName, std::string_view key,
+                          std::string *charset = nullptr) const;
+    // 从已拆分的参数（键为小写）中取出 key 的值，RFC 2231 的处理同 parameter()。
+    // IMAP BODYSTRUCTURE 给出的参数表也用它合并
+    static std::string combineParameter(std::vector<std::pair<std::string, std::string>> params,
+                                        std::string_view key, std::string *charset = nullptr);
+
+    std::string charset(int index) const;
+    std::string transferEncoding(int index) const;
+    // 附件名，可能仍是 RFC 2047 编码字
+    std::string fileName(int index, std::string *charset = nullptr) const;
+    bool isAttachment(int index) const;
+
+    std::string_view body(int index) const;
+    std::string decodedBody(int index) const;
+
+private:
+    enum State { InHeaders, InBody };
+
+    void parseLines();
+    void handleLine(std::size_t start, std::size_t end, std::size_t next);
+    void endHeaders(std::size_t bodyStart);
+    void closeBody(int index, std::size_t lineStart);
+    int matchBoundary(std::string_view line, bool &closing) const;
+
+    std::string_view view(const Span &span) const { return std::string_view(m_buffer).substr(span.offset, span.length); }
+
+    std::string m_buffer;
+    std::size_t m_parsed = 0;          // 已解析到的位置（总在行首）
+    std::vector<Part> m_parts;
+    std::vector<int> m_multiparts;     // 仍在等待结束分隔符的 multipart
+    int m_current = 0;
+    State m_state = InHeaders;
+    bool m_finished = false;
+};
+
+#endif // MIMEVIEW_H
@@ -0,0 +1,205 @@
+#include "mimewriter.h"
+#include "mimecodec.h"
+#include <random>
+#include <cstdio>
+
+namespace {
+
+// 每次读取的附件数据，编码后约 78K
+const std::size_t kReadSize = MimeCodec::kBase64LineInput * 1024;
+// 单个编码字最多容纳的原文字节数，编码后不超过 RFC 2047 的 75 个字符
+const std::size_t kEncodedWordInput = 45;
+
+bool isPlainAscii(std::string_view text)
+{
+    for (char ch : text) {
+        const unsigned char byte = static_cast<unsigned char>(ch);
+        if (byte < 0x20 || byte >= 0x7F) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string quoted(std::string_view text)
+{
+    std::string result = "\"";
+    for (char ch : text) {
+        if (ch == '"' || ch == '\\') {
+            result.push_back('\\');
+        }
+        result.push_back(ch);
+    }
+    result.push_back('"');
+    return result;
+}
+
+// RFC 2231 扩展参数值
+std::string percentEncode(std::string_view text)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    std::string result = "UTF-8''";
+    for (char ch : text) {
+        const unsigned char byte = static_cast<unsigned char>(ch);
+        if ((byte >= '0' && byte <= '9') || (byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z')
+            || byte == '-' || byte == '.' || byte == '_' || byte == '~') {
+            result.push_back(ch);
+        } else {
+            result.push_back('%');
+            result.push_back(hex[byte >> 4]);
+            result.push_back(hex[byte & 0x0F]);
+        }
+    }
+    return result;
+}
+
+std::string makeBoundary()
+{
+    std::random_device device;
+    std::mt19937_64 generator((static_cast<unsigned long long>(device()) << 32) | device());
+    char buffer[40];
+    std::snprintf(buffer, sizeof(buffer), "=_YanynEmail_%016llx",
+                  static_cast<unsigned long long>(generator()));
+    return buffer;
+}
+
+} // namespace
+
+MimeWriter::MimeWriter(Message message, bool withEnvelopeHeaders)
+    : m_message(std::move(message))
+    , m_boundary(makeBoundary())
+    , m_withEnvelopeHeaders(withEnvelopeHeaders)
+{
+}
+
+std::string MimeWriter::encodeHeader(std::string_view text)
+{
+    if (isPlainAscii(text)) {
+        return std::string(text);
+    }
+
+    std::string result;
+    std::size_t offset = 0;
+    while (offset < text.size()) {
+        // 在 UTF-8 字符边界处切分
+        std::size_t end = std::min(text.size(), offset + kEncodedWordInput);
+        while (end < text.size() && end > offset + 1
+               && (static_cast<unsigned char>(text[end]) & 0xC0) == 0x80) {
+            --end;
+        }
+        if (!result.empty()) {
+            result += "\r\n ";
+        }
+        result += "=?UTF-8?B?" + MimeCodec::base64Encode(text.substr(offset, end - offset)) + "?=";
+        offset = end;
+    }
+    return result;
+}
+
+std::string MimeWriter::envelopeHeaders(const Message &message)
+{
+    std::string headers = "From: " + message.from + "\r\n";
+    headers += "To: ";
+    for (std::size_t i = 0; i < message.to.size(); ++i) {
+        headers += (i == 0 ? "" : ",\r\n ") + message.to[i];
+    }
+    headers += "\r\n";
+    headers += "Subject: " + encodeHeader(message.subject) + "\r\n";
+    if (!message.date.empty()) {
+        headers += "Date: " + message.date + "\r\n";
+    }
+    if (!message.messageId.empty()) {
+        headers += "Message-ID: " + message.messageId + "\r\n";
+    }
+    return headers;
+}
+
+void MimeWriter::writeHeaders()
+{
+    if (m_withEnvelopeHeaders) {
+        m_out += envelopeHeaders(m_message);
+    }
+    m_out += "MIME-Version: 1.0\r\n";
+    if (!m_message.attachments.empty()) {
+        m_out += "Content-Type: multipart/mixed; boundary=\"" + m_boundary + "\"\r\n\r\n";
+        m_out += "--" + m_boundary + "\r\n";
+    }
+}
+
+void MimeWriter::writeText()
+{
+    m_out += std::string("Content-Type: text/") + (m_message.html ? "html" : "plain") + "; charset=utf-8\r\n";
+    m_out += "Content-Transfer-Encoding: base64\r\n\r\n";
+
+    const std::size_t start = m_out.size();
+    m_out.resize(start + MimeCodec::base64EncodedLinesSize(m_message.body.size()));
+    m_out.resize(start + MimeCodec::base64EncodeLines(m_message.body.data(), m_message.body.size(),
+                                                      m_out.data() + start));
+    // 正文已经编码，不再需要原文
+    std::string().swap(m_message.body);
+}
+
+void MimeWriter::writeAttachmentHeader(const Attachment &attachment)
+{
+    const std::string &name = attachment.fileName;
+    m_out += "--" + m_boundary + "\r\n";
+    m_out += "Content-Type: " + (attachment.contentType.empty() ? std::string("application/octet-stream")
+                                                                 : attachment.contentType);
+    // 老客户端只认 name 参数里的编码字，新客户端使用 RFC 2231 的 filename*
+    m_out += ";\r\n name=" + quoted(encodeHeader(name)) + "\r\n";
+    m_out += "Content-Disposition: attachment;\r\n filename";
+    m_out += isPlainAscii(name) ? "=" + quoted(name) : "*=" + percentEncode(name);
+    m_out += "\r\n";
+    m_out += "Content-Transfer-Encoding: base64\r\n\r\n";
+}
+
+bool MimeWriter::writeAttachmentData(const Attachment &attachment)
+{
+    m_in.resize(kReadSize);
+    std::size_t filled = 0;
+    while (filled < kReadSize) {
+        const std::size_t count = attachment.read(m_in.data() + filled, kReadSize - filled);
+        if (count == 0) {
+            break;
+        }
+        filled += count;
+    }
+
+    m_out.resize(MimeCodec::base64EncodedLinesSize(filled));
+    m_out.resize(MimeCodec::base64EncodeLines(m_in.data(), filled, m_out.data()));
+    return filled == kReadSize;
+}
+
+std::string_view MimeWriter::next()
+{
+    m_out.clear();
+    while (m_out.empty() && m_stage != Done) {
+        switch (m_stage) {
+        case Headers:
+            writeHeaders();
+            m_stage = Text;
+            break;
+        case Text:
+            writeText();
+            m_stage = m_message.attachments.empty() ? Done : AttachmentHeader;
+            break;
+        case AttachmentHeader:
+            writeAttachmentHeader(m_message.attachments[m_attachment]);
+            m_stage = AttachmentData;
+            break;
+        case AttachmentData:
+            if (!writeAttachmentData(m_message.attachments[m_attachment])) {
+                ++m_attachment;
+                m_stage = m_attachment < m_message.attachments.size() ? AttachmentHeader : Closing;
+            }
+            break;
+        case Closing:
+            m_out += "--" + m_boundary + "--\r\n";
+            m_stage = Done;
+            break;
+        case Done:
+            break;
+        }
+    }
+    return m_out;
+}
@@ -0,0 +1,71 @@
+#ifndef MIMEWRITER_H
+#define MIMEWRITER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <cstddef>
+
+/*
+ * 流式生成待发送的邮件
+ *
+ * 与 MimeView 相对：邮件头、正文和附件按顺序逐段生成，附件边读边做 Base64 编码，
+ * 任何时候只在内存中保留一段数据，占用与附件大小无关。
+ * next() 的返回值可以直接作为 SmtpSession::BodySource。
+ */
+class MimeWriter
+{
+public:
+    // 读取附件内容，返回读到的字节数，0 表示结束，出错时抛出异常
+    using Reader = std::function<std::size_t(char *buffer, std::size_t size)>;
+
+    struct Attachment {
+        std::string fileName;       // UTF-8
+        std::string contentType;    // 如 "application/pdf"
+        Reader read;
+    };
+
+    struct Message {
+        std::string from;
+        std::vector<std::string> to;
+        std::string subject;        // UTF-8
+        std::string date;           // RFC 5322 日期
+        std::string messageId;      // 含尖括号
+        std::string body;           // UTF-8
+        bool html = false;
+        std::vector<Attachment> attachments;
+    };
+
+    // withEnvelopeHeaders 为 false 时不生成 From、To、Subject 等收件人相关的头部，
+    // 用于群发时正文只编码一次，再与每个收件人的 envelopeHeaders() 拼接
+    explicit MimeWriter(Message message, bool withEnvelopeHeaders = true);
+
+    // 返回邮件原文（CRLF 换行）的下一段，返回空表示结束。
+    // 返回的数据在下一次调用前有效
+    std::string_view next();
+
+    // 含非 ASCII 字符时编码为 RFC 2047 编码字，多个编码字之间折行
+    static std::string encodeHeader(std::string_view text);
+    // From、To、Subject、Date、Message-ID
+    static std::string envelopeHeaders(const Message &message);
+
+private:
+    enum Stage { Headers, Text, AttachmentHeader, AttachmentData, Closing, Done };
+
+    void writeHeaders();
+    void writeText();
+    void writeAttachmentHeader(const Attachment &attachment);
+    // 读满一段再编码，保证除最后一段外都是 57 字节的整数倍，各段的 Base64 行可以直接拼接
+    bool writeAttachmentData(const Attachment &attachment);
+
+    Message m_message;
+    std::string m_boundary;
+    std::string m_out;
+    std::vector<char> m_in;
+    std::size_t m_attachment = 0;
+    Stage m_stage = Headers;
+    bool m_withEnvelopeHeaders;
+};
+
+#endif // MIMEWRITER_H
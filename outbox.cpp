@@ -0,0 +1,206 @@
+#include "outbox.h"
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QUuid>
+#include <QMutexLocker>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+const quint32 kOutboxMagic = 0x424F4D59;   // "YMOB"
+const quint32 kOutboxVersion = 1;
+
+const qint64 kFirstRetryMs = 30 * 1000;
+const qint64 kMaxRetryMs = 60 * 60 * 1000;
+
+} // namespace
+
+Outbox::Outbox() = default;
+
+bool Outbox::open(const QString &directory)
+{
+    close();
+
+    QMutexLocker locker(&m_mutex);
+    if (!QDir().mkpath(directory)) {
+        qWarning() << "无法创建发件箱目录:" << directory;
+        return false;
+    }
+    m_directory = directory;
+
+    const QStringList files = QDir(directory).entryList({"*.msg"}, QDir::Files);
+    for (const QString &name : files) {
+        QFile file(directory + "/" + name);
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+
+        QDataStream in(&file);
+        in.setVersion(QDataStream::Qt_5_15);
+        quint32 magic = 0, version = 0;
+        qint32 attempts = 0, state = 0;
+        Entry entry;
+        in >> magic >> version;
+        if (magic != kOutboxMagic || version != kOutboxVersion) {
+            qWarning() << "无法识别的发件箱文件:" << name;
+            continue;
+        }
+        in >> entry.id >> entry.account >> entry.emailId >> entry.to >> entry.subject >> entry.body
+           >> entry.isHtml >> entry.attachments >> entry.created >> entry.nextAttempt
+           >> attempts >> state >> entry.lastError;
+        if (in.status() != QDataStream::Ok) {
+            qWarning() << "发件箱文件已损坏:" << name;
+            continue;
+        }
+        entry.attempts = attempts;
+        entry.state = static_cast<State>(state);
+        // 上次退出时正在发送的邮件不知道是否已送达，按待发送处理
+        if (entry.state == Sending) {
+            entry.state = Queued;
+        }
+        m_entries.insert(entry.id, entry);
+    }
+
+    qDebug() << "打开发件箱:" << directory << "待发送:" << m_entries.size();
+    return true;
+}
+
+void Outbox::close()
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+    m_directory.clear();
+}
+
+QString Outbox::fileName(const QString &id) const
+{
+    return m_directory + "/" + id + ".msg";
+}
+
+bool Outbox::save(const Entry &entry)
+{
+    QSaveFile file(fileName(entry.id));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << kOutboxMagic << kOutboxVersion;
+    out << entry.id << entry.account << entry.emailId << entry.to << entry.subject << entry.body
+        << entry.isHtml << entry.attachments << entry.created << entry.nextAttempt
+        << static_cast<qint32>(entry.attempts) << static_cast<qint32>(entry.state) << entry.lastError;
+    return file.commit();
+}
+
+bool Outbox::enqueue(Entry &entry)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_directory.isEmpty()) {
+        return false;
+    }
+
+    entry.id = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    entry.created = QDateTime::currentDateTimeUtc();
+    entry.nextAttempt = entry.created;
+    entry.attempts = 0;
+    entry.state = Queued;
+    entry.lastError.clear();
+    if (!save(entry)) {
+        qWarning() << "写入发件箱失败:" << entry.id;
+        return false;
+    }
+    m_entries.insert(entry.id, entry);
+    return true;
+}
+
+QList<Outbox::Entry> Outbox::entries() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.values();
+}
+
+bool Outbox::takeDue(const QString &account, const QDateTime &now, Entry &entry)
+{
+    QMutexLocker locker(&m_mutex);
+    Entry *due = nullptr;
+    for (Entry &candidate : m_entries) {
+        if (candidate.account != account || (candidate.state != Queued && candidate.state != Retrying)) {
+            continue;
+        }
+        if (candidate.nextAttempt > now) {
+            continue;
+        }
+        // 先写的先发
+        if (!due || candidate.created < due->created) {
+            due = &candidate;
+        }
+    }
+    if (!due) {
+        return false;
+    }
+
+    due->state = Sending;
+    save(*due);
+    entry = *due;
+    return true;
+}
+
+qint64 Outbox::msecsUntilDue(const QString &account, const QDateTime &now) const
+{
+    QMutexLocker locker(&m_mutex);
+    qint64 result = -1;
+    for (const Entry &entry : m_entries) {
+        if (entry.account != account || (entry.state != Queued && entry.state != Retrying)) {
+            continue;
+        }
+        const qint64 wait = std::max<qint64>(0, now.msecsTo(entry.nextAttempt));
+        if (result < 0 || wait < result) {
+            result = wait;
+        }
+    }
+    return result;
+}
+
+void Outbox::markSent(const QString &id)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_entries.remove(id) > 0) {
+        QFile::remove(fileName(id));
+    }
+}
+
+QDateTime Outbox::markRetry(const QString &id, const QString &error)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.find(id);
+    if (it == m_entries.end()) {
+        return QDateTime();
+    }
+
+    // 30 秒起，每次加倍，最长 1 小时
+    const int shift = std::min(it->attempts, 7);
+    const qint64 delay = std::min(kFirstRetryMs << shift, kMaxRetryMs);
+    ++it->attempts;
+    it->state = Retrying;
+    it->lastError = error;
+    it->nextAttempt = QDateTime::currentDateTimeUtc().addMSecs(delay);
+    save(*it);
+    return it->nextAttempt;
+}
+
+void Outbox::markFailed(const QString &id, const QString &error)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.find(id);
+    if (it == m_entries.end()) {
+        return;
+    }
+    ++it->attempts;
+    it->state = Failed;
+    it->lastError = error;
+    save(*it);
+}
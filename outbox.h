@@ -0,0 +1,77 @@
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+#include <QList>
+#include <QMutex>
+#include <QMap>
+
+/*
+ * 发件箱
+ *
+ * 撰写完成的邮件先写入账户存储目录下的 outbox/，每封一个文件，
+ * 发送成功后才删除，程序崩溃或离线时不会丢失。
+ * 暂时性失败（网络不可用、SMTP 4xx）按指数退避重试，永久性失败（5xx）保留在发件箱中
+ * 并标记为失败。所有方法都是线程安全的。
+ */
+class Outbox
+{
+public:
+    enum State {
+        Sent = 0,       // 已发送（不再在发件箱中）
+        Queued = 1,
+        Sending = 2,
+        Retrying = 3,
+        Failed = 4
+    };
+
+    struct Entry {
+        QString id;
+        QString account;        // 发件账户，只用该账户的 SMTP 连接发送
+        QString emailId;        // 已发送文件夹中对应邮件的 id
+        QString to;
+        QString subject;
+        QString body;
+        bool isHtml = false;
+        QStringList attachments;
+        QDateTime created;
+        QDateTime nextAttempt;
+        int attempts = 0;
+        State state = Queued;
+        QString lastError;
+    };
+
+    Outbox();
+
+    Outbox(const Outbox&) = delete;
+    Outbox& operator=(const Outbox&) = delete;
+
+    bool open(const QString &directory);
+    void close();
+
+    // 写入磁盘后返回，分配 entry.id
+    bool enqueue(Entry &entry);
+    QList<Entry> entries() const;
+
+    // 取出该账户下一封到期的邮件并标记为发送中
+    bool takeDue(const QString &account, const QDateTime &now, Entry &entry);
+    // 距离该账户下一封邮件到期的毫秒数，没有待发邮件时返回 -1
+    qint64 msecsUntilDue(const QString &account, const QDateTime &now) const;
+
+    void markSent(const QString &id);
+    // 暂时性失败，返回下次重试的时间
+    QDateTime markRetry(const QString &id, const QString &error);
+    void markFailed(const QString &id, const QString &error);
+
+private:
+    bool save(const Entry &entry);
+    QString fileName(const QString &id) const;
+
+    mutable QMutex m_mutex;
+    QString m_directory;
+    QMap<QString, Entry> m_entries;
+};
+
+#endif // OUTBOX_H
@@ -0,0 +1,116 @@
+#include "pop3seenset.h"
+#include <QSaveFile>
+#include <QFile>
+#include <QDataStream>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+const quint32 kSeenMagic = 0x5053594D;   // "YMSP"
+const quint32 kSeenVersion = 1;
+
+bool hashLess(const Pop3SeenSet::Entry &entry, quint64 hash)
+{
+    return entry.hash < hash;
+}
+
+} // namespace
+
+quint64 Pop3SeenSet::hash(std::string_view uidl)
+{
+    // FNV-1a，跨平台、跨版本结果一致，可以写入文件
+    quint64 value = 14695981039346656037ULL;
+    for (char ch : uidl) {
+        value ^= static_cast<unsigned char>(ch);
+        value *= 1099511628211ULL;
+    }
+    return value;
+}
+
+const Pop3SeenSet::Entry *Pop3SeenSet::find(quint64 hash) const
+{
+    auto it = std::lower_bound(m_entries.begin(), m_entries.end(), hash, hashLess);
+    return it != m_entries.end() && it->hash == hash ? &*it : nullptr;
+}
+
+void Pop3SeenSet::insert(quint64 hash, quint32 uid, qint64 seen)
+{
+    auto it = std::lower_bound(m_entries.begin(), m_entries.end(), hash, hashLess);
+    if (it != m_entries.end() && it->hash == hash) {
+        if (it->uid == 0) {
+            it->uid = uid;
+            it->seen = seen;
+        }
+        return;
+    }
+    m_entries.insert(it, Entry{hash, uid, seen});
+}
+
+int Pop3SeenSet::keepOnly(std::vector<quint64> present)
+{
+    std::sort(present.begin(), present.end());
+    const auto removed = std::remove_if(m_entries.begin(), m_entries.end(), [&present](const Entry &entry) {
+        return !std::binary_search(present.begin(), present.end(), entry.hash);
+    });
+    const int count = static_cast<int>(m_entries.end() - removed);
+    m_entries.erase(removed, m_entries.end());
+    return count;
+}
+
+void Pop3SeenSet::clear()
+{
+    m_entries.clear();
+    m_lastUid = 0;
+}
+
+bool Pop3SeenSet::load(const QString &fileName)
+{
+    clear();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_15);
+
+    quint32 magic = 0, version = 0, count = 0;
+    in >> magic >> version;
+    if (magic != kSeenMagic || version != kSeenVersion) {
+        return false;
+    }
+
+    in >> m_lastUid >> count;
+    m_entries.reserve(count);
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        Entry entry;
+        in >> entry.hash >> entry.uid >> entry.seen;
+        m_entries.push_back(entry);
+    }
+
+    if (in.status() != QDataStream::Ok || !std::is_sorted(m_entries.begin(), m_entries.end(),
+            [](const Entry &a, const Entry &b) { return a.hash < b.hash; })) {
+        qWarning() << "POP3 已下载记录已损坏:" << fileName;
+        clear();
+        return false;
+    }
+    return true;
+}
+
+bool Pop3SeenSet::save(const QString &fileName) const
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << kSeenMagic << kSeenVersion << m_lastUid << static_cast<quint32>(m_entries.size());
+    for (const Entry &entry : m_entries) {
+        out << entry.hash << entry.uid << entry.seen;
+    }
+    return file.commit();
+}
@@ -0,0 +1,49 @@
+#ifndef POP3SEENSET_H
+#define POP3SEENSET_H
+
+#include <QString>
+#include <QtGlobal>
+#include <string_view>
+#include <vector>
+
+/*
+ * 已下载的 POP3 邮件集合
+ *
+ * POP3 没有 UID 同步状态，只能靠 UIDL 判断哪些邮件已经下载过。
+ * 这里记录每个 UIDL 的 64 位哈希、分配给它的本地 UID 和首次下载的时间，
+ * 按哈希排序存放在一个数组中，每封邮件占 20 字节，整个文件一次读入。
+ * 本地 UID 从 1 开始递增，用作本地存储中的邮件 UID，服务器上的邮件序号每次会话都会变化。
+ *
+ * 本类不加锁，只在 EmailClient 的工作线程中使用。
+ */
+class Pop3SeenSet
+{
+public:
+    struct Entry {
+        quint64 hash = 0;
+        quint32 uid = 0;      // 0 表示只记为已见、没有下载（旧版本首次同步时跳过的邮件），同步时补下载
+        qint64 seen = 0;      // 下载的时间（秒），保留期限从这里算起
+    };
+
+    static quint64 hash(std::string_view uidl);
+
+    bool isEmpty() const { return m_entries.empty(); }
+    int size() const { return static_cast<int>(m_entries.size()); }
+    const Entry *find(quint64 hash) const;
+    // 已有 uid 为 0 的记录时补上本地 UID 和下载时间
+    void insert(quint64 hash, quint32 uid, qint64 seen);
+    // 分配新的本地 UID，不小于 floor + 1（记录文件丢失时避开本地存储中已有的 UID）
+    quint32 allocateUid(quint32 floor = 0) { m_lastUid = qMax(m_lastUid, floor) + 1; return m_lastUid; }
+    // 只保留 present 中的哈希（服务器上已删除的邮件不再记录），返回删除的数量
+    int keepOnly(std::vector<quint64> present);
+
+    void clear();
+    bool load(const QString &fileName);
+    bool save(const QString &fileName) const;
+
+private:
+    std::vector<Entry> m_entries;   // 按 hash 升序
+    quint32 m_lastUid = 0;
+};
+
+#endif // POP3SEENSET_H
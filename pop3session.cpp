@@ -0,0 +1,102 @@
+#include "pop3session.h"
+#include "linereader.h"
+#include <boost/algorithm/string.hpp>
+#include <algorithm>
+
+namespace {
+
+bool isOk(std::string_view line)
+{
+    return line.substr(0, 3) == "+OK";
+}
+
+} // namespace
+
+const std::vector<std::string> &Pop3Session::capabilities()
+{
+    if (m_capabilitiesLoaded) {
+        return m_capabilities;
+    }
+
+    m_capabilities.clear();
+    dlg_->send("CAPA");
+    DialogLineReader reader(dlg_, is_start_tls_);
+    if (isOk(reader.readLine())) {
+        readMultiline(reader);
+        // 每行一个能力，关键字后可能带参数，如 "SASL PLAIN LOGIN"
+        std::string_view rest = m_message;
+        while (!rest.empty()) {
+            const std::size_t end = rest.find("\r\n");
+            const std::string_view line = rest.substr(0, end);
+            if (!line.empty()) {
+                m_capabilities.push_back(boost::to_upper_copy(std::string(line.substr(0, line.find(' ')))));
+            }
+            rest = end == std::string_view::npos ? std::string_view() : rest.substr(end + 2);
+        }
+    }
+    m_capabilitiesLoaded = true;
+    return m_capabilities;
+}
+
+bool Pop3Session::hasCapability(const std::string &capability)
+{
+    const std::string wanted = boost::to_upper_copy(capability);
+    const std::vector<std::string> &caps = capabilities();
+    return std::find(caps.begin(), caps.end(), wanted) != caps.end();
+}
+
+void Pop3Session::readMultiline(LineReader &reader)
+{
+    m_message.clear();
+    while (true) {
+        std::string_view line = reader.readLine();
+        if (!line.empty() && line.front() == '.') {
+            if (line.size() == 1) {
+                return;
+            }
+            line.remove_prefix(1);
+        }
+        m_message.append(line.data(), line.size());
+        m_message.append("\r\n");
+    }
+}
+
+std::vector<unsigned long> Pop3Session::fetch(const std::vector<unsigned long> &numbers, bool headerOnly,
+                                              const MessageHandler &handler, std::size_t window)
+{
+    std::vector<unsigned long> failed;
+    if (numbers.empty()) {
+        return failed;
+    }
+    if (window == 0 || !hasCapability("PIPELINING")) {
+        window = 1;
+    }
+
+    auto command = [headerOnly](unsigned long number) {
+        return (headerOnly ? "TOP " : "RETR ") + std::to_string(number) + (headerOnly ? " 0\r\n" : "\r\n");
+    };
+
+    DialogLineReader reader(dlg_, is_start_tls_);
+    std::string batch;
+    std::size_t sent = 0;
+    for (std::size_t received = 0; received < numbers.size(); ++received) {
+        // 在途命令不足一半时补满窗口，一次写出
+        if (sent - received <= window / 2 && sent < numbers.size()) {
+            batch.clear();
+            for (; sent < numbers.size() && sent - received < window; ++sent) {
+                batch += command(numbers[sent]);
+            }
+            DialogIo::write(*dlg_, is_start_tls_, batch);
+        }
+
+        const unsigned long number = numbers[received];
+        if (!isOk(reader.readLine())) {
+            // -ERR 没有数据部分，后续命令的响应照常到达
+            failed.push_back(number);
+            continue;
+        }
+        readMultiline(reader);
+        handler(number, m_message);
+    }
+    return failed;
+}
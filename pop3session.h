@@ -0,0 +1,56 @@
+#ifndef POP3SESSION_H
+#define POP3SESSION_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <cstddef>
+#include "libs/mailio/include/pop3.hpp"
+
+class LineReader;
+
+/*
+ * mailio::pop3 的扩展
+ *
+ * 与 ImapSession、SmtpSession 相同，通过继承使用受保护的 dlg_ 和 is_start_tls_。
+ *
+ * 批量的 fetch() 代替逐封调用 mailio::pop3::fetch()：服务器在 CAPA 中声明
+ * PIPELINING（RFC 2449）时最多同时有 window 条 RETR/TOP 在途，响应边到达边解析，
+ * 下载速度取决于带宽而不是往返延迟；不支持时退回一问一答。
+ * 邮件原文通过 LineReader 按块读取，不经过 mailio 的 MIME 解析。
+ */
+class Pop3Session : public mailio::pop3
+{
+public:
+    // 一封邮件的原文（已去掉点转义，CRLF 换行），只在回调期间有效
+    using MessageHandler = std::function<void(unsigned long number, std::string_view message)>;
+
+    static const std::size_t kPipelineWindow = 32;
+
+    using mailio::pop3::pop3;
+    using mailio::pop3::fetch;
+
+    // 底层连接，用法同 ImapSession::connection()
+    std::weak_ptr<mailio::dialog> connection() const { return dlg_; }
+
+    // 查询服务器能力（CAPA），结果会缓存；服务器不支持 CAPA 时为空
+    const std::vector<std::string> &capabilities();
+    bool hasCapability(const std::string &capability);
+
+    // 按顺序取回多封邮件，headerOnly 时使用 TOP n 0 只取邮件头。
+    // 返回被服务器拒绝（-ERR）的邮件序号，连接出错时抛出异常
+    std::vector<unsigned long> fetch(const std::vector<unsigned long> &numbers, bool headerOnly,
+                                     const MessageHandler &handler, std::size_t window = kPipelineWindow);
+
+protected:
+    // 读取多行响应的数据部分直到单独的 "."，去掉点转义后写入 m_message
+    void readMultiline(LineReader &reader);
+
+    std::vector<std::string> m_capabilities;
+    bool m_capabilitiesLoaded = false;
+    std::string m_message;   // 复用以避免每封邮件重新分配
+};
+
+#endif // POP3SESSION_H
@@ -0,0 +1,388 @@
+#include "searchindex.h"
+#include <QSaveFile>
+#include <QFile>
+#include <QDataStream>
+#include <QStringView>
+#include <QDebug>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+const quint32 kSearchMagic = 0x49534D59;   // "YMSI"
+const quint32 kSearchVersion = 1;
+
+const int kMaxWordLength = 40;       // 更长的通常是编码数据或链接
+const size_t kMaxTail = 64;
+const int kMaxPrefixTerms = 256;     // 前缀展开的词数上限，保证输入时的响应速度
+
+bool isCjk(char32_t ch)
+{
+    switch (QChar::script(ch)) {
+    case QChar::Script_Han:
+    case QChar::Script_Hiragana:
+    case QChar::Script_Katakana:
+    case QChar::Script_Hangul:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void appendUcs4(QString &text, char32_t ch)
+{
+    if (QChar::requiresSurrogates(ch)) {
+        text.append(QChar(QChar::highSurrogate(ch)));
+        text.append(QChar(QChar::lowSurrogate(ch)));
+    } else {
+        text.append(QChar(static_cast<char16_t>(ch)));
+    }
+}
+
+void appendVarint(QByteArray &out, quint32 value)
+{
+    while (value >= 0x80) {
+        out.append(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+} // namespace
+
+SearchIndex::SearchIndex() = default;
+
+std::vector<SearchIndex::Token> SearchIndex::tokenize(const QString &text, TokenizeMode mode)
+{
+    std::vector<Token> tokens;
+    QString word;
+    std::vector<char32_t> cjk;
+
+    auto flushWord = [&]() {
+        if (!word.isEmpty() && word.size() <= kMaxWordLength) {
+            tokens.push_back({word, false});
+        }
+        word.clear();
+    };
+
+    auto flushCjk = [&]() {
+        if (cjk.size() == 1) {
+            // 单字查询按前缀匹配以该字开头的所有词
+            QString term;
+            appendUcs4(term, cjk[0]);
+            tokens.push_back({term, mode == QueryMode});
+        } else if (cjk.size() > 1) {
+            for (size_t i = 0; i + 1 < cjk.size(); ++i) {
+                QString term;
+                appendUcs4(term, cjk[i]);
+                appendUcs4(term, cjk[i + 1]);
+                tokens.push_back({term, false});
+            }
+            if (mode == IndexMode) {
+                QString term;
+                appendUcs4(term, cjk.back());
+                tokens.push_back({term, false});
+            }
+        }
+        cjk.clear();
+    };
+
+    const QList<uint> chars = text.normalized(QString::NormalizationForm_KC).toCaseFolded().toUcs4();
+    for (uint value : chars) {
+        const char32_t ch = static_cast<char32_t>(value);
+        if (isCjk(ch)) {
+            flushWord();
+            cjk.push_back(ch);
+        } else if (QChar::isLetterOrNumber(ch)) {
+            flushCjk();
+            appendUcs4(word, ch);
+        } else {
+            flushWord();
+            flushCjk();
+        }
+    }
+    flushWord();
+    flushCjk();
+    return tokens;
+}
+
+void SearchIndex::addPosting(Postings &postings, quint32 doc)
+{
+    if (postings.blockCount == 0 || doc > postings.blockLast) {
+        appendVarint(postings.block, doc - postings.blockLast);
+        postings.blockLast = doc;
+        ++postings.blockCount;
+        return;
+    }
+    if (doc == postings.blockLast) {
+        return;
+    }
+
+    auto it = std::lower_bound(postings.tail.begin(), postings.tail.end(), doc);
+    if (it != postings.tail.end() && *it == doc) {
+        return;
+    }
+    postings.tail.insert(it, doc);
+    if (postings.tail.size() > kMaxTail) {
+        compact(postings);
+    }
+}
+
+std::vector<quint32> SearchIndex::decode(const Postings &postings)
+{
+    std::vector<quint32> docs;
+    docs.reserve(postings.blockCount);
+
+    const uchar *p = reinterpret_cast<const uchar *>(postings.block.constData());
+    const uchar *end = p + postings.block.size();
+    quint32 doc = 0;
+    while (p < end) {
+        quint32 delta = 0;
+        int shift = 0;
+        while (p < end) {
+            const uchar byte = *p++;
+            delta |= static_cast<quint32>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                break;
+            }
+            shift += 7;
+        }
+        doc += delta;
+        docs.push_back(doc);
+    }
+
+    if (!postings.tail.empty()) {
+        std::vector<quint32> merged;
+        merged.reserve(docs.size() + postings.tail.size());
+        std::merge(docs.begin(), docs.end(), postings.tail.begin(), postings.tail.end(),
+                   std::back_inserter(merged));
+        merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+        docs.swap(merged);
+    }
+    return docs;
+}
+
+void SearchIndex::compact(Postings &postings)
+{
+    const std::vector<quint32> docs = decode(postings);
+    postings.block.clear();
+    postings.blockLast = 0;
+    postings.blockCount = 0;
+    postings.tail.clear();
+    for (quint32 doc : docs) {
+        appendVarint(postings.block, doc - postings.blockLast);
+        postings.blockLast = doc;
+        ++postings.blockCount;
+    }
+}
+
+void SearchIndex::addText(const QString &emailId, const QString &text)
+{
+    auto it = m_docIds.constFind(emailId);
+    quint32 doc;
+    if (it != m_docIds.constEnd()) {
+        doc = it.value();
+    } else {
+        doc = static_cast<quint32>(m_docs.size());
+        m_docs.push_back({emailId, false});
+        m_docIds.insert(emailId, doc);
+    }
+
+    for (const Token &token : tokenize(text, IndexMode)) {
+        addPosting(m_terms[token.term], doc);
+    }
+}
+
+void SearchIndex::removeByPrefix(const QString &prefix)
+{
+    // 倒排表中的旧文档号留到查询时过滤
+    for (auto it = m_docIds.begin(); it != m_docIds.end();) {
+        if (it.key().startsWith(prefix)) {
+            m_docs[it.value()].deleted = true;
+            it = m_docIds.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void SearchIndex::clear()
+{
+    m_docs.clear();
+    m_docIds.clear();
+    m_terms.clear();
+}
+
+std::vector<quint32> SearchIndex::lookup(const Token &token) const
+{
+    if (!token.prefix) {
+        auto it = m_terms.find(token.term);
+        return it == m_terms.end() ? std::vector<quint32>() : decode(it->second);
+    }
+
+    std::vector<quint32> docs;
+    int expanded = 0;
+    for (auto it = m_terms.lower_bound(token.term);
+         it != m_terms.end() && it->first.startsWith(token.term) && expanded < kMaxPrefixTerms;
+         ++it, ++expanded) {
+        const std::vector<quint32> termDocs = decode(it->second);
+        docs.insert(docs.end(), termDocs.begin(), termDocs.end());
+    }
+    std::sort(docs.begin(), docs.end());
+    docs.erase(std::unique(docs.begin(), docs.end()), docs.end());
+    return docs;
+}
+
+QStringList SearchIndex::search(const QString &query, int limit) const
+{
+    QStringList result;
+    std::vector<Token> tokens = tokenize(query, QueryMode);
+    if (tokens.empty()) {
+        return result;
+    }
+
+    // 正在输入的最后一个词按前缀匹配，单个字母除外，否则展开的词太多
+    if (!query.back().isSpace() && tokens.back().term.size() >= 2) {
+        tokens.back().prefix = true;
+    }
+
+    std::vector<std::vector<quint32>> lists;
+    lists.reserve(tokens.size());
+    for (const Token &token : tokens) {
+        lists.push_back(lookup(token));
+        if (lists.back().empty()) {
+            return result;
+        }
+    }
+
+    // 从最短的倒排表开始求交集
+    std::sort(lists.begin(), lists.end(), [](const std::vector<quint32> &a, const std::vector<quint32> &b) {
+        return a.size() < b.size();
+    });
+    std::vector<quint32> docs = std::move(lists.front());
+    for (size_t i = 1; i < lists.size() && !docs.empty(); ++i) {
+        std::vector<quint32> next;
+        std::set_intersection(docs.begin(), docs.end(), lists[i].begin(), lists[i].end(),
+                              std::back_inserter(next));
+        docs.swap(next);
+    }
+
+    for (auto it = docs.rbegin(); it != docs.rend() && result.size() < limit; ++it) {
+        const Document &document = m_docs[*it];
+        if (!document.deleted) {
+            result.append(document.id);
+        }
+    }
+    return result;
+}
+
+bool SearchIndex::load(const QString &fileName)
+{
+    clear();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_15);
+
+    quint32 magic = 0, version = 0, docCount = 0, termCount = 0;
+    in >> magic >> version;
+    if (magic != kSearchMagic || version != kSearchVersion) {
+        return false;
+    }
+
+    in >> docCount;
+    m_docs.reserve(docCount);
+    for (quint32 i = 0; i < docCount && in.status() == QDataStream::Ok; ++i) {
+        Document document;
+        in >> document.id >> document.deleted;
+        if (!document.deleted) {
+            m_docIds.insert(document.id, i);
+        }
+        m_docs.push_back(document);
+    }
+
+    in >> termCount;
+    for (quint32 i = 0; i < termCount && in.status() == QDataStream::Ok; ++i) {
+        QString term;
+        Postings postings;
+        in >> term >> postings.block >> postings.blockLast >> postings.blockCount;
+        m_terms.emplace(term, std::move(postings));
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        qWarning() << "搜索索引已损坏，将重建:" << fileName;
+        clear();
+        return false;
+    }
+    return true;
+}
+
+bool SearchIndex::save(const QString &fileName)
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << kSearchMagic << kSearchVersion;
+
+    out << static_cast<quint32>(m_docs.size());
+    for (const Document &document : m_docs) {
+        out << document.id << document.deleted;
+    }
+
+    out << static_cast<quint32>(m_terms.size());
+    for (auto &entry : m_terms) {
+        if (!entry.second.tail.empty()) {
+            compact(entry.second);
+        }
+        out << entry.first << entry.second.block << entry.second.blockLast << entry.second.blockCount;
+    }
+
+    return file.commit();
+}
+
+QString SearchIndex::stripHtml(const QString &html)
+{
+    QString text;
+    text.reserve(html.size());
+    const QStringView view(html);
+    const qsizetype size = view.size();
+
+    qsizetype i = 0;
+    while (i < size) {
+        const QChar ch = view[i];
+        if (ch == QLatin1Char('<')) {
+            // <script>、<style> 的内容不是正文
+            for (const QLatin1String tag : {QLatin1String("script"), QLatin1String("style")}) {
+                if (view.mid(i + 1, tag.size()).compare(tag, Qt::CaseInsensitive) == 0) {
+                    const qsizetype close = html.indexOf(QString("</") + tag, i, Qt::CaseInsensitive);
+                    i = close < 0 ? size : close;
+                    break;
+                }
+            }
+            const qsizetype end = html.indexOf(QLatin1Char('>'), i);
+            i = end < 0 ? size : end + 1;
+            text.append(QLatin1Char(' '));
+            continue;
+        }
+        if (ch == QLatin1Char('&')) {
+            // &nbsp; 之类的实体当作分隔符
+            const qsizetype end = html.indexOf(QLatin1Char(';'), i);
+            if (end > i && end - i <= 8) {
+                text.append(QLatin1Char(' '));
+                i = end + 1;
+                continue;
+            }
+        }
+        text.append(ch);
+        ++i;
+    }
+    return text;
+}
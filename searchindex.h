@@ -0,0 +1,78 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QHash>
+#include <map>
+#include <vector>
+
+/*
+ * 本地全文搜索索引（倒排索引）
+ *
+ * 分词：拉丁字母和数字按单词切分；中日韩文字切成相邻两字（bigram），
+ * 每段最后一个字再单独作为一个词，这样单字查询也能通过前缀匹配命中。
+ * 文本先做 NFKC 规范化和大小写折叠，全角字母与半角等价。
+ *
+ * 倒排表按文档号递增保存为变长整数差值编码；正文晚于邮件头到达时文档号可能
+ * 小于已有的最大值，这些文档号先放在有序的 tail 中，积累到一定数量再合并。
+ *
+ * 本类不加锁，由 MailStore 在持有自身互斥锁时调用。
+ */
+class SearchIndex
+{
+public:
+    SearchIndex();
+
+    // 为邮件追加可搜索的文本，同一个 id 可以多次调用（邮件头、正文分别到达）
+    void addText(const QString &emailId, const QString &text);
+    // 删除 id 以 prefix 开头的所有文档，用于 UIDVALIDITY 变化时清空文件夹
+    void removeByPrefix(const QString &prefix);
+    void clear();
+
+    // 查询中的所有词都必须出现；最后一个词和单个汉字按前缀匹配。
+    // 结果按加入索引的先后倒序（较新的邮件在前）
+    QStringList search(const QString &query, int limit) const;
+
+    bool load(const QString &fileName);
+    bool save(const QString &fileName);
+
+    int documentCount() const { return static_cast<int>(m_docs.size()); }
+
+    // 去掉 HTML 标签、脚本和样式，只保留文字
+    static QString stripHtml(const QString &html);
+
+private:
+    struct Postings {
+        QByteArray block;           // 文档号差值的变长编码
+        quint32 blockLast = 0;      // block 中最大的文档号
+        quint32 blockCount = 0;
+        std::vector<quint32> tail;  // 乱序到达的文档号，有序且不与 block 重复合并
+    };
+
+    struct Token {
+        QString term;
+        bool prefix;
+    };
+
+    enum TokenizeMode { IndexMode, QueryMode };
+
+    static std::vector<Token> tokenize(const QString &text, TokenizeMode mode);
+    static void addPosting(Postings &postings, quint32 doc);
+    static void compact(Postings &postings);
+    static std::vector<quint32> decode(const Postings &postings);
+
+    std::vector<quint32> lookup(const Token &token) const;
+
+    struct Document {
+        QString id;
+        bool deleted = false;
+    };
+
+    std::vector<Document> m_docs;
+    QHash<QString, quint32> m_docIds;
+    std::map<QString, Postings> m_terms;
+};
+
+#endif // SEARCHINDEX_H
@@ -0,0 +1,309 @@
+#include "smtpsession.h"
+#include <boost/algorithm/string.hpp>
+
+namespace {
+
+// BDAT 每块的目标大小，块总在行尾截断
+const std::size_t kChunkSize = 256 * 1024;
+
+/*
+ * 把任意分段的邮件原文整理成以 CRLF 结尾、大小约为 kChunkSize 的块。
+ * mailio::dialog::send() 总会在数据后追加 CRLF，因此块末尾的 CRLF 由它补上。
+ */
+class ChunkReader
+{
+public:
+    explicit ChunkReader(const SmtpSession::BodySource &source) : m_source(source) {}
+
+    // 取下一块，返回 false 表示没有数据了
+    bool next(std::string &chunk)
+    {
+        std::size_t cut = std::string::npos;
+        while (cut == std::string::npos) {
+            while (!m_done && m_pending.size() < m_want) {
+                read();
+            }
+            if (m_done) {
+                cut = m_pending.size();
+            } else {
+                // 在最后一个完整行之后截断，剩下的留给下一块；超长的行继续读到行尾
+                const std::size_t lineEnd = m_pending.rfind("\r\n");
+                if (lineEnd != std::string::npos) {
+                    cut = lineEnd + 2;
+                } else {
+                    m_want = m_pending.size() + kChunkSize;
+                }
+            }
+        }
+        m_want = kChunkSize;
+
+        if (m_pending.empty()) {
+            return false;
+        }
+        chunk.assign(m_pending, 0, cut);
+        m_pending.erase(0, cut);
+        if (chunk.size() < 2 || chunk.compare(chunk.size() - 2, 2, "\r\n") != 0) {
+            chunk.append("\r\n");
+        }
+        return true;
+    }
+
+    bool atEnd()
+    {
+        while (!m_done && m_pending.empty()) {
+            read();
+        }
+        return m_done && m_pending.empty();
+    }
+
+private:
+    void read()
+    {
+        const std::string_view piece = m_source();
+        if (piece.empty()) {
+            m_done = true;
+        } else {
+            m_pending.append(piece.data(), piece.size());
+        }
+    }
+
+    const SmtpSession::BodySource &m_source;
+    std::string m_pending;
+    std::size_t m_want = kChunkSize;
+    bool m_done = false;
+};
+
+} // namespace
+
+int SmtpSession::readReply(std::string *message)
+{
+    while (true) {
+        const std::string line = dlg_->receive();
+        const auto [status, last, text] = parse_line(line);
+        if (last) {
+            if (message) {
+                *message = text;
+            }
+            m_lastStatus = status;
+            m_lastReply = text;
+            return status;
+        }
+    }
+}
+
+bool SmtpSession::probe()
+{
+    try {
+        dlg_->send("RSET");
+        return positive_completion(readReply());
+    } catch (const std::exception &) {
+        return false;
+    }
+}
+
+const std::vector<std::string> &SmtpSession::extensions()
+{
+    if (m_extensionsLoaded) {
+        return m_extensions;
+    }
+
+    // mailio 的 ehlo() 丢弃了应答内容，这里在已认证的连接上重新发送一次
+    dlg_->send("EHLO " + src_host_);
+    std::vector<std::string> result;
+    bool first = true;
+    while (true) {
+        const std::string line = dlg_->receive();
+        const auto [status, last, text] = parse_line(line);
+        if (!positive_completion(status)) {
+            throw mailio::smtp_error("EHLO failure.", text);
+        }
+        // 第一行是服务器的问候语
+        if (!first) {
+            const std::string keyword = text.substr(0, text.find(' '));
+            result.push_back(boost::to_upper_copy(keyword));
+        }
+        first = false;
+        if (last) {
+            break;
+        }
+    }
+
+    m_extensions = std::move(result);
+    m_extensionsLoaded = true;
+    return m_extensions;
+}
+
+bool SmtpSession::hasExtension(const std::string &extension)
+{
+    const std::string wanted = boost::to_upper_copy(extension);
+    for (const std::string &ext : extensions()) {
+        if (ext == wanted) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<SmtpSession::Rejection> SmtpSession::sendMail(const Envelope &envelope, const BodySource &body)
+{
+    if (envelope.from.empty() || envelope.recipients.empty()) {
+        throw mailio::smtp_error("No sender or recipients.", "");
+    }
+
+    const bool pipelining = hasExtension("PIPELINING");
+    const bool chunking = hasExtension("CHUNKING");
+
+    std::vector<std::string> commands;
+    commands.reserve(envelope.recipients.size() + 1);
+    commands.push_back("MAIL FROM:<" + envelope.from + ">");
+    for (const std::string &recipient : envelope.recipients) {
+        commands.push_back("RCPT TO:<" + recipient + ">");
+    }
+
+    // 信封命令一次写出，应答按顺序读取；不支持 PIPELINING 时逐条往返。
+    // 单个收件人被拒绝不影响其他收件人，只有 MAIL FROM 失败才中止
+    std::string failure;
+    int failureStatus = 0;
+    std::vector<Rejection> rejected;
+    if (pipelining) {
+        dlg_->send(boost::algorithm::join(commands, "\r\n"));
+    }
+    for (std::size_t i = 0; i < commands.size(); ++i) {
+        if (!pipelining) {
+            dlg_->send(commands[i]);
+        }
+        std::string text;
+        const int status = readReply(&text);
+        if (positive_completion(status)) {
+            continue;
+        }
+        if (i == 0) {
+            failure = commands[i] + ": " + text;
+            failureStatus = status;
+            if (!pipelining) {
+                break;
+            }
+        } else if (failure.empty()) {
+            rejected.push_back({envelope.recipients[i - 1], status, text});
+        }
+    }
+    // 所有收件人都被拒绝时没有可投递的对象；有任何暂时性拒绝时整体按暂时性失败处理
+    if (failure.empty() && rejected.size() == envelope.recipients.size()) {
+        const Rejection &first = rejected.front();
+        failure = "RCPT TO:<" + first.recipient + ">: " + first.reply;
+        failureStatus = first.status;
+        for (const Rejection &rejection : rejected) {
+            if (rejection.status < 500) {
+                failureStatus = rejection.status;
+                break;
+            }
+        }
+    }
+    if (!failure.empty()) {
+        dlg_->send("RSET");
+        readReply();
+        m_lastStatus = failureStatus;
+        m_lastReply = failure;
+        throw mailio::smtp_error("Envelope rejection.", failure);
+    }
+
+    if (chunking) {
+        sendBdat(body, pipelining);
+    } else {
+        sendData(body);
+    }
+    return rejected;
+}
+
+void SmtpSession::sendBdat(const BodySource &body, bool pipelining)
+{
+    ChunkReader reader(body);
+    std::string chunk;
+    std::string frame;
+    std::size_t pendingReplies = 0;
+    std::string failure;
+    int failureStatus = 0;
+
+    auto collect = [this, &pendingReplies, &failure, &failureStatus]() {
+        while (pendingReplies > 0) {
+            std::string text;
+            const int status = readReply(&text);
+            --pendingReplies;
+            if (!positive_completion(status) && failure.empty()) {
+                failure = text;
+                failureStatus = status;
+            }
+        }
+    };
+
+    bool last = false;
+    while (!last) {
+        if (!reader.next(chunk)) {
+            // 空邮件或上一块恰好是全部数据时，用空块结束
+            chunk.clear();
+            last = true;
+        } else {
+            last = reader.atEnd();
+        }
+
+        frame = "BDAT " + std::to_string(chunk.size()) + (last ? " LAST" : "");
+        if (!chunk.empty()) {
+            frame += "\r\n";
+            // dialog::send() 会补上末尾的 CRLF
+            frame.append(chunk, 0, chunk.size() - 2);
+        }
+        dlg_->send(frame);
+        ++pendingReplies;
+
+        // BDAT 之间不需要等待应答（RFC 3030 第 4.2 节），服务器不支持 PIPELINING 时除外
+        if (!pipelining || last) {
+            collect();
+            if (!failure.empty()) {
+                break;
+            }
+        }
+    }
+
+    if (!failure.empty()) {
+        if (!last) {
+            dlg_->send("RSET");
+            readReply();
+        }
+        m_lastStatus = failureStatus;
+        m_lastReply = failure;
+        throw mailio::smtp_error("Message rejection.", failure);
+    }
+}
+
+void SmtpSession::sendData(const BodySource &body)
+{
+    dlg_->send("DATA");
+    std::string text;
+    if (!positive_intermediate(readReply(&text))) {
+        throw mailio::smtp_error("Data rejection.", text);
+    }
+
+    ChunkReader reader(body);
+    std::string chunk;
+    std::string escaped;
+    while (reader.next(chunk)) {
+        // 块总从行首开始，行首的点加倍（RFC 5321 第 4.5.2 节）
+        escaped.clear();
+        escaped.reserve(chunk.size() + 16);
+        bool lineStart = true;
+        for (std::size_t i = 0; i < chunk.size() - 2; ++i) {
+            const char ch = chunk[i];
+            if (lineStart && ch == '.') {
+                escaped.push_back('.');
+            }
+            escaped.push_back(ch);
+            lineStart = ch == '\n';
+        }
+        dlg_->send(escaped);
+    }
+
+    dlg_->send(".");
+    if (!positive_completion(readReply(&text))) {
+        throw mailio::smtp_error("Message rejection.", text);
+    }
+}
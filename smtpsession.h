@@ -0,0 +1,71 @@
+#ifndef SMTPSESSION_H
+#define SMTPSESSION_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include "libs/mailio/include/smtp.hpp"
+
+/*
+ * mailio::smtp 的扩展
+ *
+ * 与 ImapSession 相同，通过继承使用受保护的 dlg_ 发送 mailio 不支持的命令。
+ * 一个已认证的连接可以连续提交多封邮件，发送前用 RSET 探测连接是否仍然可用。
+ *
+ * sendMail() 代替 mailio::smtp::submit()：服务器支持 PIPELINING（RFC 2920）时
+ * MAIL FROM 和所有 RCPT TO 一次写出，再依次读取应答；支持 CHUNKING（RFC 3030）时
+ * 正文用 BDAT 分块发送，不需要点转义，否则退回 DATA。
+ */
+class SmtpSession : public mailio::smtp
+{
+public:
+    struct Envelope {
+        std::string from;
+        std::vector<std::string> recipients;
+    };
+
+    // 被 RCPT TO 拒绝的收件人及服务器的应答
+    struct Rejection {
+        std::string recipient;
+        int status = 0;
+        std::string reply;
+    };
+
+    // 按顺序返回邮件原文（CRLF 换行）的下一段，返回空表示结束。
+    // 返回的数据在下一次调用前有效
+    using BodySource = std::function<std::string_view()>;
+
+    using mailio::smtp::smtp;
+
+    // 发送 RSET 并读取应答。服务器已关闭连接或应答不是 2xx 时返回 false，不抛出异常。
+    // RSET 同时清除上一封邮件可能残留的事务状态，比 NOOP 更适合作为发送前的探测
+    bool probe();
+
+    // EHLO 应答中的扩展（大写关键字），第一次调用时重新发送 EHLO 获取
+    const std::vector<std::string> &extensions();
+    bool hasExtension(const std::string &extension);
+
+    // 提交一封邮件，返回被拒绝的收件人；只要有一个收件人被接受，邮件就发给被接受的收件人。
+    // MAIL FROM 被拒绝或所有收件人都被拒绝时抛出 smtp_error，此时事务已被 RSET，连接仍可使用
+    std::vector<Rejection> sendMail(const Envelope &envelope, const BodySource &body);
+
+    // 最近一条应答的状态码和内容，sendMail() 失败时为被拒绝的那条应答，
+    // 用于区分暂时性（4xx）和永久性（5xx）失败
+    int lastReplyStatus() const { return m_lastStatus; }
+    const std::string &lastReplyText() const { return m_lastReply; }
+
+protected:
+    // 读取一条（可能是多行的）应答，返回状态码
+    int readReply(std::string *message = nullptr);
+
+    void sendBdat(const BodySource &body, bool pipelining);
+    void sendData(const BodySource &body);
+
+    std::vector<std::string> m_extensions;
+    bool m_extensionsLoaded = false;
+    int m_lastStatus = 0;
+    std::string m_lastReply;
+};
+
+#endif // SMTPSESSION_H
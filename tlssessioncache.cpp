@@ -0,0 +1,97 @@
+#include "tlssessioncache.h"
+
+TlsSessionCache &TlsSessionCache::instance()
+{
+    static TlsSessionCache cache;
+    return cache;
+}
+
+TlsSessionCache::TlsSessionCache()
+    : m_keyIndex(SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr))
+{
+}
+
+TlsSessionCache::~TlsSessionCache()
+{
+    for (auto &entry : m_sessions) {
+        SSL_SESSION_free(entry.second);
+    }
+}
+
+void TlsSessionCache::attach(SSL_CTX *context)
+{
+    // 会话由这里按主机保存，OpenSSL 自己的客户端缓存不按主机区分，不使用
+    SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(context, &TlsSessionCache::onNewSession);
+}
+
+void TlsSessionCache::prepare(SSL *ssl, const std::string *key)
+{
+    SSL_set_ex_data(ssl, m_keyIndex, const_cast<std::string *>(key));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_sessions.find(*key);
+    if (it != m_sessions.end()) {
+        // SSL_set_session 自己增加引用计数
+        SSL_set_session(ssl, it->second);
+    }
+}
+
+void TlsSessionCache::completed(SSL *ssl, bool success)
+{
+    if (!success) {
+        if (const auto *key = static_cast<const std::string *>(SSL_get_ex_data(ssl, m_keyIndex))) {
+            remove(*key);
+        }
+        return;
+    }
+    if (SSL_session_reused(ssl)) {
+        ++m_resumed;
+    } else {
+        ++m_full;
+    }
+}
+
+TlsSessionCache::Stats TlsSessionCache::stats() const
+{
+    Stats stats;
+    stats.resumed = m_resumed.load();
+    stats.full = m_full.load();
+    return stats;
+}
+
+int TlsSessionCache::onNewSession(SSL *ssl, SSL_SESSION *session)
+{
+    TlsSessionCache &cache = instance();
+    const auto *key = static_cast<const std::string *>(SSL_get_ex_data(ssl, cache.m_keyIndex));
+    if (!key || !SSL_SESSION_is_resumable(session)) {
+        return 0;
+    }
+    // 保存副本：连接未正常关闭（SSL_shutdown）时 OpenSSL 会把原会话标记为不可复用，
+    // 而本程序的连接通常是直接断开的
+    SSL_SESSION *copy = SSL_SESSION_dup(session);
+    if (copy) {
+        cache.store(*key, copy);
+    }
+    return 0;
+}
+
+void TlsSessionCache::store(const std::string &key, SSL_SESSION *session)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SSL_SESSION *&slot = m_sessions[key];
+    if (slot) {
+        SSL_SESSION_free(slot);
+    }
+    slot = session;
+}
+
+void TlsSessionCache::remove(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_sessions.find(key);
+    if (it != m_sessions.end()) {
+        SSL_SESSION_free(it->second);
+        m_sessions.erase(it);
+    }
+}
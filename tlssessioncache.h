@@ -0,0 +1,57 @@
+#ifndef TLSSESSIONCACHE_H
+#define TLSSESSIONCACHE_H
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <openssl/ssl.h>
+
+/*
+ * 客户端 TLS 会话缓存
+ *
+ * 每次重新连接都做完整握手要多一次往返和一次非对称运算。这里按 "主机:端口" 保存
+ * 服务器发来的会话（TLS 1.2 的会话 ID 或 TLS 1.3 的会话票据），下次握手前交给 OpenSSL 复用。
+ * TLS 1.3 的票据在握手完成后才到达，由 SSL_CTX 的新会话回调收下，同一主机只保留最新的一个。
+ *
+ * 用法：attach() 配置共享的 SSL_CTX；每个连接握手前 prepare()，握手结束后 completed()。
+ * key 字符串由连接持有，必须在 SSL 对象存活期间保持有效。所有方法都是线程安全的。
+ */
+class TlsSessionCache
+{
+public:
+    struct Stats {
+        std::uint64_t resumed = 0;
+        std::uint64_t full = 0;
+    };
+
+    static TlsSessionCache &instance();
+
+    void attach(SSL_CTX *context);
+    void prepare(SSL *ssl, const std::string *key);
+    // 握手失败时丢弃该主机的会话，下次做完整握手
+    void completed(SSL *ssl, bool success);
+
+    // 复用会话的握手和完整握手的次数
+    Stats stats() const;
+
+    TlsSessionCache(const TlsSessionCache&) = delete;
+    TlsSessionCache& operator=(const TlsSessionCache&) = delete;
+
+private:
+    TlsSessionCache();
+    ~TlsSessionCache();
+
+    static int onNewSession(SSL *ssl, SSL_SESSION *session);
+    void store(const std::string &key, SSL_SESSION *session);
+    void remove(const std::string &key);
+
+    mutable std::mutex m_mutex;
+    std::map<std::string, SSL_SESSION *> m_sessions;
+    int m_keyIndex;   // SSL 对象上保存 key 指针的扩展数据下标
+    std::atomic<std::uint64_t> m_resumed{0};
+    std::atomic<std::uint64_t> m_full{0};
+};
+
+#endif // TLSSESSIONCACHE_H